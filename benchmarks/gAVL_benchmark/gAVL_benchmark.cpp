@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gAVL.h>
+#include <gAVLBTree.h>
+
+using namespace bst;
+
+// Hot path microbenchmarks: insert, contains, search_neighbors, to_stl_vector and remove, for n = 10^3 up to max_n values
+// (10^6 unless given, up to 10^8 if memory allows), each under three key patterns:
+//   random       distinct keys inserted and looked up in random order
+//   sorted       inserted and looked up in ascending order
+//   adversarial  inserted zig-zagging between the two ends (a rotation on nearly every insert), looked up with keys that
+//                all miss, and search_neighbors with a condition that rejects 1023 of every 1024 values, forcing long scans
+//
+// Usage: gAVL_benchmark [max_n] [name filter]
+
+// Same values as std::int64_t, but a distinct type, so trees over it get the compact node layout
+struct compact_key {
+	compact_key() : v(0) {}
+	compact_key(std::int64_t x) : v(x) {}
+
+	bool operator<(const compact_key& other) const { return v < other.v; }
+
+	std::int64_t v;
+};
+
+namespace bst {
+	template <>
+	struct gAVLCompactNode<compact_key> : std::true_type {};
+}
+
+static std::int64_t value(std::int64_t k) { return k; }
+static std::int64_t value(const compact_key& k) { return k.v; }
+
+// Accepts 1 value in 1024, so the neighbour searches have to step over the rest
+struct sparse_condition {
+	template <typename K>
+	bool operator()(const K& k) const {
+		return (value(k) & 2047) == 0;
+	}
+};
+
+// Defeats dead code elimination of the results
+static std::size_t sink = 0;
+
+// Every ordered set under test is driven through one of these
+template <typename Tree, typename Key = std::int64_t>
+struct gAVL_subject {
+	void insert(std::int64_t k) { sink += tree.insert(Key(k)); }
+	void remove(std::int64_t k) { sink += tree.remove(Key(k)); }
+	void contains(std::int64_t k) { sink += tree.contains(Key(k)); }
+
+	template <typename Condition>
+	void neighbors(std::int64_t k, Condition condition) {
+		std::map<typename Tree::Position, Key> ref;
+
+		sink += tree.search_neighbors(Key(k), ref, condition);
+	}
+
+	void flatten() { sink += tree.to_stl_vector().size(); }
+
+	Tree tree;
+};
+
+struct std_set_subject {
+	void insert(std::int64_t k) { sink += tree.insert(k).second; }
+	void remove(std::int64_t k) { sink += tree.erase(k); }
+	void contains(std::int64_t k) { sink += tree.count(k); }
+
+	// What search_neighbors does, in terms of std::set -- into the same kind of map, so both sides pay for filling it
+	template <typename Condition>
+	void neighbors(std::int64_t k, Condition condition) {
+		typedef gAVL<std::int64_t>::Position Position;
+		std::map<Position, std::int64_t> ref;
+		std::set<std::int64_t>::const_iterator at = tree.lower_bound(k);
+		std::set<std::int64_t>::const_iterator it = at;
+
+		while (it != tree.begin()) {
+			--it;
+
+			if (condition(*it)) {
+				ref.insert(std::pair<Position, std::int64_t>(Position::Before, *it));
+				break;
+			}
+		}
+
+		if (at != tree.end() && *at == k) {
+			ref.insert(std::pair<Position, std::int64_t>(Position::Equal, *at));
+			++at;
+		}
+
+		for (; at != tree.end(); ++at) {
+			if (condition(*at)) {
+				ref.insert(std::pair<Position, std::int64_t>(Position::After, *at));
+				break;
+			}
+		}
+
+		sink += !ref.empty();
+	}
+
+	void flatten() { sink += std::vector<std::int64_t>(tree.begin(), tree.end()).size(); }
+
+	std::set<std::int64_t> tree;
+};
+
+struct pattern {
+	const char* name;
+	std::vector<std::int64_t> keys;			// Insert/remove order
+	std::vector<std::int64_t> probes;		// Lookup order
+	bool sparse;							// Whether the neighbour searches use sparse_condition
+};
+
+static pattern make_pattern(const char* name, std::size_t n, std::mt19937_64& rng) {
+	pattern p;
+
+	p.name = name;
+	p.sparse = false;
+	p.keys.reserve(n);
+
+	// Keys are even, so adding one gives a key that misses
+	if (std::strcmp(name, "random") == 0) {
+		for (std::size_t i = 0; i < n; ++i) {
+			p.keys.push_back(static_cast<std::int64_t>(2 * i));
+		}
+
+		std::shuffle(p.keys.begin(), p.keys.end(), rng);
+		p.probes = p.keys;
+		std::shuffle(p.probes.begin(), p.probes.end(), rng);
+	} else if (std::strcmp(name, "sorted") == 0) {
+		for (std::size_t i = 0; i < n; ++i) {
+			p.keys.push_back(static_cast<std::int64_t>(2 * i));
+		}
+
+		p.probes = p.keys;
+	} else {
+		for (std::size_t lo = 0, hi = n; lo < hi;) {
+			p.keys.push_back(static_cast<std::int64_t>(2 * lo++));
+
+			if (lo < hi) {
+				p.keys.push_back(static_cast<std::int64_t>(2 * --hi));
+			}
+		}
+
+		p.probes = p.keys;
+		std::shuffle(p.probes.begin(), p.probes.end(), rng);
+
+		for (std::int64_t& k : p.probes) {
+			k++;
+		}
+
+		p.sparse = true;
+	}
+
+	return p;
+}
+
+static void report(const char* subject, const pattern& p, const char* op, std::chrono::steady_clock::duration elapsed, std::size_t ops) {
+	double ns = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>((ops > 0) ? ops : 1);
+
+	std::printf("%-18s %-12s %10zu  %-17s %10.1f ns/op\n", subject, p.name, p.keys.size(), op, ns);
+	std::fflush(stdout);
+}
+
+template <typename Subject>
+static void run(const char* subject, const pattern& p, const std::string& filter) {
+	if (!filter.empty() && std::string(subject).find(filter) == std::string::npos) {
+		return;
+	}
+
+	typedef std::chrono::steady_clock clock;
+
+	// Built on the heap so that 10^8 values don't have to fit on the stack of anything
+	std::unique_ptr<Subject> s(new Subject());
+	std::size_t n = p.keys.size();
+	std::size_t queries = std::min<std::size_t>(n, p.sparse ? 10000 : 1000000);
+
+	clock::time_point t = clock::now();
+
+	for (std::int64_t k : p.keys) {
+		s->insert(k);
+	}
+
+	report(subject, p, "insert", clock::now() - t, n);
+
+	t = clock::now();
+
+	for (std::int64_t k : p.probes) {
+		s->contains(k);
+	}
+
+	report(subject, p, "contains", clock::now() - t, n);
+
+	t = clock::now();
+
+	for (std::size_t i = 0; i < queries; ++i) {
+		if (p.sparse) {
+			s->neighbors(p.probes[i], sparse_condition());
+		} else {
+			s->neighbors(p.probes[i], gAVLAlways());
+		}
+	}
+
+	report(subject, p, "search_neighbors", clock::now() - t, queries);
+
+	t = clock::now();
+	s->flatten();
+	report(subject, p, "to_stl_vector", clock::now() - t, n);
+
+	t = clock::now();
+
+	for (std::int64_t k : p.keys) {
+		s->remove(k);
+	}
+
+	report(subject, p, "remove", clock::now() - t, n);
+}
+
+int main(int argc, char** argv) {
+	std::size_t max_n = (argc > 1) ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : 1000000;
+	std::string filter = (argc > 2) ? argv[2] : "";
+	std::mt19937_64 rng(20170101);
+
+	std::printf("%-18s %-12s %10s  %-17s %10s\n", "subject", "pattern", "n", "operation", "time");
+
+	for (std::size_t n = 1000; n <= max_n; n *= 10) {
+		for (const char* name : {"random", "sorted", "adversarial"}) {
+			pattern p = make_pattern(name, n, rng);
+
+			run<std_set_subject>("std::set", p, filter);
+			run<gAVL_subject<gAVL<std::int64_t>>>("gAVL", p, filter);
+			run<gAVL_subject<gAVL<std::int64_t, gAVLCompare<std::int64_t>, gAVLPool<std::int64_t>>>>("gAVL+gAVLPool", p, filter);
+			run<gAVL_subject<gAVL<std::int64_t, gAVLCompare<std::int64_t>, std::allocator<std::int64_t>, gAVLNoAugment, gAVLStats>>>("gAVL+gAVLStats", p, filter);
+			run<gAVL_subject<gAVL<compact_key>, compact_key>>("gAVL compact", p, filter);
+			run<gAVL_subject<gAVL<compact_key, gAVLCompare<compact_key>, gAVLPool<compact_key>>, compact_key>>("gAVL compact+pool", p, filter);
+			run<gAVL_subject<gAVLBTree<std::int64_t>>>("gAVLBTree", p, filter);
+		}
+	}
+
+	return (sink == 0) ? 1 : 0;
+}
@@ -7,22 +7,24 @@
 
 using namespace bst;
 
-// The comparator function 
+// The comparator function object
 // If a and b are equal, return 0
 // If a should come before b, return -1 (or any negative int)
 // If a should come after b, return 1 (or any positive int)
-std::function<int(const double&, const double&)> comparator = [](const double& a, const double& b) -> int {
-	if (std::fabs(a - b) < std::numeric_limits<double>::epsilon()) {
-		return 0;
-	} else if (a < b) {
-		return -1;
-	} 
-
-	return 1;
+struct comparator {
+	int operator()(const double& a, const double& b) const {
+		if (std::fabs(a - b) < std::numeric_limits<double>::epsilon()) {
+			return 0;
+		} else if (a < b) {
+			return -1;
+		} 
+
+		return 1;
+	}
 };
 
 int main(void) {
-	gAVL<double> tree(comparator);
+	gAVL<double, comparator> tree;
 
 	/*** CHANGE FOR FUN (2^k random doubles will be generated for this test) ***/
 	// I'm not responsible for stdout buffer flooding
@@ -61,8 +63,8 @@ int main(void) {
 	auto height_bounds = tree.height_bounds();
 
 	// Show respect for theoretical upper and lower tree height bounds
-	std::cout << " Upper Bound Height: " << std::get<1>(tree.height_bounds()) << std::endl;
-	std::cout << "      Actual Height: " << tree.height() << std::endl;
+	std::cout << " Upper Bound Height: " << std::get<1>(height_bounds) << std::endl;
+	std::cout << "      Actual Height: " << height << std::endl;
 	std::cout << "     Size (# items): " << tree.size() << std::endl << std::endl;
 
 	assert(std::get<0>(height_bounds) <= height && height <= std::get<1>(height_bounds));
@@ -83,8 +85,11 @@ int main(void) {
 	std::cout << std::endl;
 
 	// Again, respect for upper/lower bounds
-	std::cout << " Upper Bound Height: " << std::get<1>(tree.height_bounds()) << std::endl;
-	std::cout << "      Actual Height: " << tree.height() << std::endl;
+	height = tree.height();
+	height_bounds = tree.height_bounds();
+
+	std::cout << " Upper Bound Height: " << std::get<1>(height_bounds) << std::endl;
+	std::cout << "      Actual Height: " << height << std::endl;
 	std::cout << "     Size (# items): " << tree.size() << std::endl << std::endl;
 
 	assert(std::get<0>(height_bounds) <= height && height <= std::get<1>(height_bounds));
@@ -105,8 +110,11 @@ int main(void) {
 	std::cout << std::endl;
 
 	// More upper/lower bounds assurances
-	std::cout << " Upper Bound Height: " << std::get<1>(tree.height_bounds()) << std::endl;
-	std::cout << "      Actual Height: " << tree.height() << std::endl;
+	height = tree.height();
+	height_bounds = tree.height_bounds();
+
+	std::cout << " Upper Bound Height: " << std::get<1>(height_bounds) << std::endl;
+	std::cout << "      Actual Height: " << height << std::endl;
 	std::cout << "     Size (# items): " << tree.size() << std::endl << std::endl;
 
 	assert(std::get<0>(height_bounds) <= height && height <= std::get<1>(height_bounds));
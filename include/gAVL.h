@@ -2,513 +2,3658 @@
 #define GAVL_H_
 
 #include <memory>
+#include <utility>
+#include <iterator>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <type_traits>
 #include <functional>
 #include <vector>
-#include <stack>
 #include <queue>
 #include <map>
+#include <tuple>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
 
 namespace bst {
+	// A slab allocator for gAVL nodes -- single-object requests are carved out of contiguous chunks of ChunkSize slots
+	// and recycled through an intrusive free list, anything bigger falls through to the global heap.
+	// Copies share the same slabs (so several trees can draw from one pool), rebinding to another type starts a fresh pool.
+	// Chunks are only returned to the heap when the last copy goes away. Not thread-safe, just like gAVL itself.
+	template <typename T, std::size_t ChunkSize = 1024>
+	class gAVLPool {
+		public:
+			typedef T value_type;
+			typedef std::true_type propagate_on_container_copy_assignment;
+			typedef std::true_type propagate_on_container_move_assignment;
+			typedef std::true_type propagate_on_container_swap;
+
+			template <typename U>
+			struct rebind {
+				typedef gAVLPool<U, ChunkSize> other;
+			};
+
+			gAVLPool();
+			template <typename U> gAVLPool(const gAVLPool<U, ChunkSize>& other);
+
+			T* allocate(std::size_t n);
+			void deallocate(T* p, std::size_t n);
+
+			std::size_t capacity() const;			// Returns the number of slots carved out of the heap so far [O(1)]
+
+			template <typename U> bool operator==(const gAVLPool<U, ChunkSize>& other) const;
+			template <typename U> bool operator!=(const gAVLPool<U, ChunkSize>& other) const;
+
+		protected:
+			template <typename U, std::size_t N> friend class gAVLPool;
+
+			union Slot {
+				Slot* _next;
+				typename std::aligned_storage<sizeof(T), alignof(T)>::type _storage;
+			};
+
+			struct Slabs {
+				Slabs() : _free(nullptr), _used(ChunkSize) {}
+				~Slabs() {
+					for (Slot* chunk : _chunks) {
+						delete[] chunk;
+					}
+				}
+
+				std::vector<Slot*> _chunks;
+				Slot* _free;		// Recycled slots
+				std::size_t _used;	// Slots handed out of the newest chunk
+			};
+
+			std::shared_ptr<Slabs> _slabs;
+	};
+
+	template <typename T, std::size_t ChunkSize>
+	gAVLPool<T, ChunkSize>::gAVLPool(): _slabs(std::make_shared<Slabs>()) {
+		static_assert(ChunkSize > 0, "gAVLPool needs at least one slot per chunk");
+	}
+
+	template <typename T, std::size_t ChunkSize>
+	template <typename U>
+	gAVLPool<T, ChunkSize>::gAVLPool(const gAVLPool<U, ChunkSize>&): _slabs(std::make_shared<Slabs>()) {
+	}
+
+	template <typename T, std::size_t ChunkSize>
+	T* gAVLPool<T, ChunkSize>::allocate(std::size_t n) {
+		if (n != 1) {
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		}
+
+		Slabs& slabs = *_slabs;
+		Slot* slot = slabs._free;
+
+		if (slot != nullptr) {
+			slabs._free = slot->_next;
+		} else {
+			if (slabs._used == ChunkSize) {
+				slabs._chunks.reserve(slabs._chunks.size() + 1);
+				slabs._chunks.push_back(new Slot[ChunkSize]);
+				slabs._used = 0;
+			}
+
+			slot = slabs._chunks.back() + slabs._used++;
+		}
+
+		return reinterpret_cast<T*>(slot);
+	}
+
+	template <typename T, std::size_t ChunkSize>
+	void gAVLPool<T, ChunkSize>::deallocate(T* p, std::size_t n) {
+		if (n != 1) {
+			::operator delete(p);
+			return;
+		}
+
+		Slot* slot = reinterpret_cast<Slot*>(p);
+		slot->_next = _slabs->_free;
+		_slabs->_free = slot;
+	}
+
+	template <typename T, std::size_t ChunkSize>
+	std::size_t gAVLPool<T, ChunkSize>::capacity() const {
+		return _slabs->_chunks.size() * ChunkSize;
+	}
+
+	template <typename T, std::size_t ChunkSize>
+	template <typename U>
+	bool gAVLPool<T, ChunkSize>::operator==(const gAVLPool<U, ChunkSize>& other) const {
+		return static_cast<const void*>(_slabs.get()) == static_cast<const void*>(other._slabs.get());
+	}
+
+	template <typename T, std::size_t ChunkSize>
+	template <typename U>
+	bool gAVLPool<T, ChunkSize>::operator!=(const gAVLPool<U, ChunkSize>& other) const {
+		return !(*this == other);
+	}
+
+	// Augmentation policies keep a summary of each subtree in its root node (node_data is mixed into every gAVLNode)
+	// update(node) recomputes that summary from the node's own value and its children's summaries, the tree calls it on every node
+	// whose subtree changed (rotations, and the path to the root after an insert or remove), bottom-up
+	// enabled == false lets the tree skip those walks entirely
+
+	// No augmentation, costs nothing
+	struct gAVLNoAugment {
+		static const bool enabled = false;
+
+		struct node_data {};
+
+		template <typename Node>
+		static void update(Node*) {}
+	};
+
+	// Order statistics -- subtree sizes, enabling select(k), rank(x) and count_range(lo, hi) in O(log(n))
+	struct gAVLCountAugment {
+		static const bool enabled = true;
+
+		struct node_data {
+			node_data() : _count(1) {}
+
+			std::size_t _count;		// Number of nodes in the subtree rooted here
+		};
+
+		template <typename Node>
+		static void update(Node* node) {
+			node->_count = 1 + ((node->_left != nullptr) ? node->_left->_count : 0) + ((node->_right != nullptr) ? node->_right->_count : 0);
+		}
+	};
+
+	// Subtree summaries -- Summary is a monoid over T, supplied as
+	//   typedef ... value_type;
+	//   static value_type lift(const T& data);								// Summary of a single value
+	//   static value_type combine(const value_type& a, const value_type& b);	// Summary of the values of a followed by those of b
+	// e.g. a bitmask of flags OR'ed together, or the minimum of some field, which lets the search_* functions skip whole subtrees
+	template <typename Summary>
+	struct gAVLSummaryAugment {
+		static const bool enabled = true;
+
+		struct node_data {
+			typename Summary::value_type _summary;	// Summary of the subtree rooted here
+		};
+
+		template <typename Node>
+		static void update(Node* node) {
+			typename Summary::value_type summary = Summary::lift(node->_data);
+
+			if (node->_left != nullptr) {
+				summary = Summary::combine(node->_left->_summary, summary);
+			}
+
+			if (node->_right != nullptr) {
+				summary = Summary::combine(summary, node->_right->_summary);
+			}
+
+			node->_summary = summary;
+		}
+	};
+
+	// Interval tree -- T is an interval [low, high], Interval supplied as
+	//   typedef ... endpoint_type;							// Ordered by operator<
+	//   static endpoint_type low(const T& data);
+	//   static endpoint_type high(const T& data);				// Not before low(data)
+	// Keeps the highest high() of every subtree, enabling overlapping(a, b, visitor) and any_overlap(a, b), which skip each subtree
+	// ending before a. The comparator has to order the intervals by low() first, how it breaks ties is up to it
+	template <typename Interval>
+	struct gAVLIntervalAugment {
+		static const bool enabled = true;
+
+		struct node_data {
+			typedef Interval interval_type;
+
+			typename Interval::endpoint_type _max_high;	// Highest high() in the subtree rooted here
+		};
+
+		template <typename Node>
+		static void update(Node* node) {
+			node->_max_high = Interval::high(node->_data);
+
+			if (node->_left != nullptr && node->_max_high < node->_left->_max_high) {
+				node->_max_high = node->_left->_max_high;
+			}
+
+			if (node->_right != nullptr && node->_max_high < node->_right->_max_high) {
+				node->_max_high = node->_right->_max_high;
+			}
+		}
+	};
+
+	// Interval of gAVLIntervalAugment for std::pair<E, E> values holding [first, second], which gAVLCompare already orders by first
+	template <typename E>
+	struct gAVLPairInterval {
+		typedef E endpoint_type;
+
+		static const E& low(const std::pair<E, E>& data) { return data.first; }
+		static const E& high(const std::pair<E, E>& data) { return data.second; }
+	};
+
+	// Two augmentations at once, e.g. gAVLAugments<gAVLCountAugment, gAVLSummaryAugment<Summary>>
+	template <typename A, typename B>
+	struct gAVLAugments {
+		static const bool enabled = A::enabled || B::enabled;
+
+		struct node_data : public A::node_data, public B::node_data {};
+
+		template <typename Node>
+		static void update(Node* node) {
+			A::update(node);
+			B::update(node);
+		}
+	};
+
+	// Hands a node's subtree summary to a user supplied subtree condition
+	template <typename SubtreeCondition>
+	struct gAVLSummaryGate {
+		explicit gAVLSummaryGate(SubtreeCondition& subtree_condition) : _subtree_condition(subtree_condition) {}
+
+		template <typename Node>
+		bool operator()(const Node* node) const {
+			return _subtree_condition(node->_summary);
+		}
+
+		SubtreeCondition& _subtree_condition;
+	};
+
+	// Statistics policies count what a tree's hot paths do, gAVL::stats() hands out a snapshot of the counts
+	// The tree reports every comparison, rotation, level climbed while rebalancing, node allocation/deallocation, and value a
+	// search_* condition is tried on, to the policy it was given. Counts stay with the tree object, assignment doesn't carry them over
+
+	// What a tree did since it was built, or since reset_stats()
+	struct gAVLCounters {
+		gAVLCounters() : comparisons(0), left_rotations(0), right_rotations(0), left_right_rotations(0), right_left_rotations(0), retraces(0), retrace_levels(0), allocations(0), deallocations(0), scans(0), scan_visits(0) {}
+
+		std::uint64_t comparisons;			// Comparator calls
+		std::uint64_t left_rotations;		// rotate_left
+		std::uint64_t right_rotations;		// rotate_right
+		std::uint64_t left_right_rotations;	// rotate_left_right
+		std::uint64_t right_left_rotations;	// rotate_right_left
+		std::uint64_t retraces;				// Rebalancing walks up from an inserted or removed node
+		std::uint64_t retrace_levels;		// Levels those walks climbed, retrace_levels / retraces is their mean depth
+		std::uint64_t allocations;			// Nodes allocated
+		std::uint64_t deallocations;		// Nodes freed
+		std::uint64_t scans;				// Condition scans of search_neighbors/search_before/search_after, one per direction
+		std::uint64_t scan_visits;			// Values a condition was tried on by those scans, scan_visits / scans near size() means they degraded toward O(n)
+	};
+
+	enum class gAVLRotation : int {
+		Left,
+		Right,
+		LeftRight,
+		RightLeft
+	};
+
+	// No statistics, every call compiles away
+	struct gAVLNoStats {
+		static const bool enabled = false;
+
+		void compared() {}
+		void rotated(gAVLRotation) {}
+		void retraced() {}
+		void climbed() {}
+		void allocated() {}
+		void deallocated() {}
+		void scanned() {}
+		void visited() {}
+
+		gAVLCounters snapshot() const { return gAVLCounters(); }
+		void reset() {}
+		void absorb(const gAVLNoStats&) {}
+	};
+
+	// Every count of gAVLCounters -- relaxed atomic increments (a locked add apiece on x86), so that several threads can still
+	// read the tree at once. Costs a few ns per event, meant for finding out where the time goes rather than for every tree
+	struct gAVLStats {
+		static const bool enabled = true;
+
+		gAVLStats() { reset(); }
+
+		void compared() { bump(_counts[0]); }
+		void rotated(gAVLRotation rotation) { bump(_counts[1 + static_cast<int>(rotation)]); }
+		void retraced() { bump(_counts[5]); }
+		void climbed() { bump(_counts[6]); }
+		void allocated() { bump(_counts[7]); }
+		void deallocated() { bump(_counts[8]); }
+		void scanned() { bump(_counts[9]); }
+		void visited() { bump(_counts[10]); }
+
+		gAVLCounters snapshot() const {
+			gAVLCounters counters;
+			std::uint64_t* out[count] = { &counters.comparisons, &counters.left_rotations, &counters.right_rotations, &counters.left_right_rotations, &counters.right_left_rotations, &counters.retraces, &counters.retrace_levels, &counters.allocations, &counters.deallocations, &counters.scans, &counters.scan_visits };
+
+			for (std::size_t i = 0; i < count; ++i) {
+				*out[i] = _counts[i].load(std::memory_order_relaxed);
+			}
+
+			return counters;
+		}
+
+		void reset() {
+			for (std::size_t i = 0; i < count; ++i) {
+				_counts[i].store(0, std::memory_order_relaxed);
+			}
+		}
+
+		// Adds the counts of other, e.g. those of the scratch trees a fork-join operation ran its tasks on
+		void absorb(const gAVLStats& other) {
+			for (std::size_t i = 0; i < count; ++i) {
+				_counts[i].fetch_add(other._counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			}
+		}
+
+		protected:
+			static const std::size_t count = 11;	// In gAVLCounters' order
+
+		static void bump(std::atomic<std::uint64_t>& counter) { counter.fetch_add(1, std::memory_order_relaxed); }
+
+		std::atomic<std::uint64_t> _counts[count];
+	};
+
+	// Whether nodes can be allocated and freed from several threads at once through (copies of) an Allocator, which the parallel bulk operations rely on
+	// gAVLPool is not, specialize this for any other allocator that is
+	template <typename Allocator>
+	struct gAVLConcurrentAllocator : std::false_type {};
+
+	template <typename U>
+	struct gAVLConcurrentAllocator<std::allocator<U>> : std::true_type {};
+
+	// Whether the nodes of trees over T keep their balance factor in the low bits of the parent link, which alignment leaves
+	// unused, instead of in an int of its own (padded out to a whole word) -- 32 instead of 40 bytes per node for double or int
+	// on 64 bit targets, for the price of masking the parent link on every use of it. Specialize as std::true_type to opt in
+	template <typename T>
+	struct gAVLCompactNode : std::false_type {};
+
+	// Parent link of a compact node, the balance factor + 1 (0 to 2) rides along in its two low bits
+	template <typename Node>
+	class gAVLPackedParent {
+		public:
+			gAVLPackedParent() : _bits(1) {}
+			gAVLPackedParent(const gAVLPackedParent&) = delete;
+
+			gAVLPackedParent& operator=(const gAVLPackedParent& other) { return *this = static_cast<Node*>(other); }	// The link alone, the balance factor stays
+			gAVLPackedParent& operator=(Node* parent) { _bits = reinterpret_cast<std::uintptr_t>(parent) | (_bits & mask); return *this; }
+			operator Node*() const { return reinterpret_cast<Node*>(_bits & ~mask); }
+			Node* operator->() const { return *this; }
+
+			int balance_factor() const { return static_cast<int>(_bits & mask) - 1; }
+			void set_balance_factor(int balance_factor) { _bits = (_bits & ~mask) | static_cast<std::uintptr_t>(balance_factor + 1); }
+
+		protected:
+			static const std::uintptr_t mask = 3;
+
+			std::uintptr_t _bits;
+	};
+
+	// What the child links of the nodes of trees with augmentation Augment (and the root link of the tree) are, and what the
+	// insert and remove paths do right before they change the child links of a node -- raw pointers and nothing by default,
+	// gAVLConcurrent specializes this for the links its lookups follow while a write is going on
+	template <typename Node, typename Augment>
+	struct gAVLLinks {
+		typedef Node* type;
+
+		static void relinking(Node*) {}
+	};
+
+	// Links are raw pointers: a gAVL owns every node reachable from its _root and frees them itself
+	template <typename T, typename Augment = gAVLNoAugment, bool Compact = gAVLCompactNode<T>::value>
+	struct gAVLNode : public Augment::node_data {
+		// The value is built in place from whatever arguments the tree was handed
+		template <typename... Args>
+		explicit gAVLNode(Args&&... args) : _data(std::forward<Args>(args)...), _parent(nullptr), _left(nullptr), _right(nullptr), _balance_factor(0) {}
+
+		int balance_factor() const { return _balance_factor; }
+		void set_balance_factor(int balance_factor) { _balance_factor = balance_factor; }
+
+		T _data;
+
+		gAVLNode* _parent;
+		typename gAVLLinks<gAVLNode, Augment>::type _left;
+		typename gAVLLinks<gAVLNode, Augment>::type _right;
+		int _balance_factor;
+	};
+
+	template <typename T, typename Augment>
+	struct gAVLNode<T, Augment, true> : public Augment::node_data {
+		static_assert(std::alignment_of<std::uintptr_t>::value >= 4, "Compact nodes need two free low bits in a pointer to a node");
+
+		template <typename... Args>
+		explicit gAVLNode(Args&&... args) : _data(std::forward<Args>(args)...), _left(nullptr), _right(nullptr) {}
+
+		int balance_factor() const { return _parent.balance_factor(); }
+		void set_balance_factor(int balance_factor) { _parent.set_balance_factor(balance_factor); }
+
+		T _data;
+
+		gAVLPackedParent<gAVLNode> _parent;
+		typename gAVLLinks<gAVLNode, Augment>::type _left;
+		typename gAVLLinks<gAVLNode, Augment>::type _right;
+	};
+
+	// The default comparator, built from operator< -- negative if a comes before b, zero if equal, positive if a comes after b
 	template <typename T>
-	struct gAVLNode {
-		gAVLNode() : _parent(nullptr), _left(nullptr), _right(nullptr), _balance_factor(0) {}
-		gAVLNode(std::shared_ptr<gAVLNode> parent, std::shared_ptr<gAVLNode> left, std::shared_ptr<gAVLNode> right) : _parent(parent), _left(left), _right(right), _balance_factor(0) {}
+	struct gAVLCompare {
+		int operator()(const T& a, const T& b) const {
+			if (a < b) {
+				return -1;
+			} else if (b < a) {
+				return 1;
+			}
+
+			return 0;
+		}
+	};
+
+	// Transparent flavour of the default comparator -- compares any a and b that operator< can, so lookups can probe with a key type
+	// other than T (e.g. a std::string id against records ordered by that id) without building a T first
+	template <>
+	struct gAVLCompare<void> {
+		typedef void is_transparent;
+
+		template <typename A, typename B>
+		int operator()(const A& a, const B& b) const {
+			if (a < b) {
+				return -1;
+			} else if (b < a) {
+				return 1;
+			}
+
+			return 0;
+		}
+	};
+
+	// The default condition of search_neighbors/search_before/search_after, accepts every value
+	struct gAVLAlways {
+		template <typename T>
+		bool operator()(const T&) const {
+			return true;
+		}
+	};
+
+	// Immutable, pointer-free copy of a set of values in Eytzinger (breadth first) order, see gAVL::freeze() -- Space O(n)
+	// The implicit tree lives in one array: the children of the k-th value (1 based) are values 2k and 2k + 1, so a lookup walks
+	// down the array without a single pointer, the next few levels of which are prefetched while the current one is compared
+	// For trivially copyable T the array can be saved as a flat image (a header, then the array as it is in memory) and later
+	// loaded back, or viewed in place -- a memory mapped image file is queried directly, pages being read in as lookups touch them
+	template <typename T, typename Compare = gAVLCompare<T>>
+	class gAVLFrozen {
+		public:
+			typedef Compare comparator_type;
+
+			enum Position {
+				Before,
+				After,
+				Equal
+			};
+
+			explicit gAVLFrozen(const Compare& comparator = Compare());	// Holds no values, until load() or view()
+			template <typename InputIt> gAVLFrozen(InputIt first, InputIt last, const Compare& comparator = Compare());	// [first, last) has to be in strict comparator order [O(n)]
+			gAVLFrozen(const gAVLFrozen& other);
+			gAVLFrozen(gAVLFrozen&& other);
+
+			gAVLFrozen& operator=(const gAVLFrozen& other);
+			gAVLFrozen& operator=(gAVLFrozen&& other);
+
+			// In comparator order, stepping through the implicit tree
+			class const_iterator {
+				public:
+					typedef std::bidirectional_iterator_tag iterator_category;
+					typedef T value_type;
+					typedef std::ptrdiff_t difference_type;
+					typedef const T* pointer;
+					typedef const T& reference;
+
+					const_iterator() : _index(0), _frozen(nullptr) {}
+
+					reference operator*() const { return _frozen->_base[_index - 1]; }
+					pointer operator->() const { return &_frozen->_base[_index - 1]; }
+
+					const_iterator& operator++() {
+						_index = _frozen->successor(_index);
+						return *this;
+					}
+
+					const_iterator operator++(int) {
+						const_iterator it = *this;
+						++(*this);
+
+						return it;
+					}
+
+					const_iterator& operator--() {
+						_index = _frozen->predecessor(_index);
+						return *this;
+					}
+
+					const_iterator operator--(int) {
+						const_iterator it = *this;
+						--(*this);
+
+						return it;
+					}
+
+					bool operator==(const const_iterator& other) const { return _index == other._index; }
+					bool operator!=(const const_iterator& other) const { return _index != other._index; }
+
+				protected:
+					const_iterator(std::size_t index, const gAVLFrozen* frozen) : _index(index), _frozen(frozen) {}
+
+					std::size_t _index;					// 1 based position in the array, 0 for end()
+					const gAVLFrozen* _frozen;
+
+					friend class gAVLFrozen;
+			};
+
+			typedef const_iterator iterator;
+
+			std::size_t size() const;				// [O(1)]
+			bool contains(const T& data) const;		// [O(log(n))]
+			bool search(const T& search_data, T& found_data) const;	// [O(log(n))]
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> bool contains(const K& key) const;
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> bool search(const K& search_key, T& found_data) const;
+			template <typename Condition = gAVLAlways> bool search_neighbors(const T& data, std::map<Position,T>& ref, Condition condition = Condition()) const;	// Same results as gAVL::search_neighbors, worst case [O(n)]
+			template <typename Condition = gAVLAlways> bool search_before(const T& data, T& ref, Condition condition = Condition()) const;	// Worst case [O(n)], typically far better
+			template <typename Condition = gAVLAlways> bool search_after(const T& data, T& ref, Condition condition = Condition()) const;	// Worst case [O(n)], typically far better
+			std::vector<T> to_stl_vector() const;	// [O(n)]
+
+			// Images are only portable between builds that agree on sizeof(T), T's layout and the byte order
+			bool save(std::ostream& out) const;		// Writes the values as an image, returns false if out failed [O(n)]
+			bool load(std::istream& in);			// Replaces the values with those of an image read from in, returns false (and holds no values) if it isn't a valid one [O(n)]
+			bool view(const void* image, std::size_t bytes);	// Looks the values up in the image in place (no copy), which has to outlive this and any copy of it -- returns false (and holds no values) if it isn't a valid one [O(1)]
+
+			const_iterator begin() const;			// [O(log(n))]
+			const_iterator end() const;				// [O(1)]
+			const_iterator lower_bound(const T& data) const;	// Position of the first value not before data, or end() [O(log(n))], without a branch on the comparisons
+			const_iterator upper_bound(const T& data) const;	// Position of the first value after data, or end() [O(log(n))], same as above
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> const_iterator lower_bound(const K& key) const;
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> const_iterator upper_bound(const K& key) const;
+
+		protected:
+			static constexpr std::size_t floor_pow2(std::size_t n) { return (n < 2) ? 1 : 2 * floor_pow2(n / 2); }
+
+			// Index multiplier reaching the descendants a cache line worth of values down (which sit next to each other)
+			static const std::size_t prefetch_stride = floor_pow2((sizeof(T) < 64) ? 64 / sizeof(T) : 1);
+
+			// Leads every image, the values follow at image_offset (a cache line in, keeping them aligned in a page aligned mapping)
+			struct ImageHeader {
+				char _magic[4];						// "gAVL"
+				std::uint32_t _version;
+				std::uint32_t _value_size;			// sizeof(T)
+				std::uint32_t _byte_order;			// image_byte_order as written, reads back differently on a machine of the other byte order
+				std::uint64_t _count;
+				std::uint64_t _offset;				// Where the values start, from the start of the image
+			};
+
+			static const std::uint32_t image_version = 1;
+			static const std::uint32_t image_byte_order = 0x01020304;
+			static const std::size_t image_offset = 64;
+
+			bool valid_header(const ImageHeader& header) const;
+			void reset();							// Back to holding no values
+
+			template <typename K> std::size_t descend(const K& key, bool inclusive) const;	// First position whose value is not before (inclusive) or after key, 0 if none
+			std::size_t successor(std::size_t k) const;
+			std::size_t predecessor(std::size_t k) const;	// predecessor(0) is the last position
+			void prefetch(std::size_t k) const;
+
+			Compare _comparator;
+			std::vector<T> _values;					// Owned storage, empty while viewing an image
+			const T* _base;							// Position k is _base[k - 1], either _values.data() or inside the image
+			std::size_t _count;
+	};
+
+	template <typename T, typename Compare>
+	gAVLFrozen<T, Compare>::gAVLFrozen(const Compare& comparator) : _comparator(comparator), _base(nullptr), _count(0) {
+	}
+
+	template <typename T, typename Compare>
+	template <typename InputIt>
+	gAVLFrozen<T, Compare>::gAVLFrozen(InputIt first, InputIt last, const Compare& comparator) : _comparator(comparator), _base(nullptr), _count(0) {
+		std::vector<T> sorted(first, last);
+		std::size_t n = sorted.size();
+
+		// An in-order walk of the implicit tree hands out the sorted values to positions, then they're moved over position by position
+		std::vector<std::size_t> order(n + 1, 0);
+		std::size_t next = 0;
+		std::size_t k = 1;
+
+		while (next < n) {
+			while (k <= n) {
+				k = 2 * k;
+			}
+
+			// Climb out of the right subtrees that are done, then up from the left child whose parent is next
+			while ((k & 1) == 1) {
+				k >>= 1;
+			}
+
+			k >>= 1;
+			order[k] = next++;
+			k = 2 * k + 1;
+		}
+
+		_values.reserve(n);
+
+		for (std::size_t i = 1; i <= n; ++i) {
+			_values.push_back(std::move(sorted[order[i]]));
+		}
+
+		_base = _values.data();
+		_count = n;
+	}
+
+	template <typename T, typename Compare>
+	gAVLFrozen<T, Compare>::gAVLFrozen(const gAVLFrozen& other) : _comparator(other._comparator), _values(other._values), _base(other._base), _count(other._count) {
+		// A copy of a view shares the image, a copy of owned values points at its own
+		if (!other._values.empty()) {
+			_base = _values.data();
+		}
+	}
+
+	template <typename T, typename Compare>
+	gAVLFrozen<T, Compare>::gAVLFrozen(gAVLFrozen&& other) : _comparator(std::move(other._comparator)), _values(std::move(other._values)), _base(other._base), _count(other._count) {
+		other.reset();
+	}
+
+	template <typename T, typename Compare>
+	gAVLFrozen<T, Compare>& gAVLFrozen<T, Compare>::operator=(const gAVLFrozen& other) {
+		if (this != &other) {
+			gAVLFrozen tmp(other);
+			*this = std::move(tmp);
+		}
+
+		return *this;
+	}
+
+	template <typename T, typename Compare>
+	gAVLFrozen<T, Compare>& gAVLFrozen<T, Compare>::operator=(gAVLFrozen&& other) {
+		if (this != &other) {
+			_comparator = std::move(other._comparator);
+			_values = std::move(other._values);
+			_base = other._base;
+			_count = other._count;
+
+			other.reset();
+		}
+
+		return *this;
+	}
+
+	template <typename T, typename Compare>
+	std::size_t gAVLFrozen<T, Compare>::size() const {
+		return _count;
+	}
+
+	template <typename T, typename Compare>
+	bool gAVLFrozen<T, Compare>::contains(const T& data) const {
+		std::size_t k = descend(data, true);
+
+		return k != 0 && _comparator(data, _base[k - 1]) == 0;
+	}
+
+	template <typename T, typename Compare>
+	bool gAVLFrozen<T, Compare>::search(const T& search_data, T& found_data) const {
+		std::size_t k = descend(search_data, true);
+
+		if (k == 0 || _comparator(search_data, _base[k - 1]) != 0) {
+			return false;
+		}
+
+		found_data = _base[k - 1];
+
+		return true;
+	}
+
+	template <typename T, typename Compare>
+	template <typename K, typename C, typename>
+	bool gAVLFrozen<T, Compare>::contains(const K& key) const {
+		std::size_t k = descend(key, true);
+
+		return k != 0 && _comparator(key, _base[k - 1]) == 0;
+	}
+
+	template <typename T, typename Compare>
+	template <typename K, typename C, typename>
+	bool gAVLFrozen<T, Compare>::search(const K& search_key, T& found_data) const {
+		std::size_t k = descend(search_key, true);
+
+		if (k == 0 || _comparator(search_key, _base[k - 1]) != 0) {
+			return false;
+		}
+
+		found_data = _base[k - 1];
+
+		return true;
+	}
+
+	template <typename T, typename Compare>
+	template <typename Condition>
+	bool gAVLFrozen<T, Compare>::search_neighbors(const T& data, std::map<Position,T>& ref, Condition condition) const {
+		std::size_t s = ref.size();
+		std::size_t k = descend(data, true);
+
+		if (k != 0 && _comparator(data, _base[k - 1]) == 0) {
+			ref.insert(std::pair<Position, T>(Equal, _base[k - 1]));
+		}
+
+		for (std::size_t j = predecessor(k); j != 0; j = predecessor(j)) {
+			if (condition(_base[j - 1])) {
+				ref.insert(std::pair<Position, T>(Before, _base[j - 1]));
+				break;
+			}
+		}
+
+		for (std::size_t j = descend(data, false); j != 0; j = successor(j)) {
+			if (condition(_base[j - 1])) {
+				ref.insert(std::pair<Position, T>(After, _base[j - 1]));
+				break;
+			}
+		}
+
+		return ref.size() > s;
+	}
+
+	template <typename T, typename Compare>
+	template <typename Condition>
+	bool gAVLFrozen<T, Compare>::search_before(const T& data, T& ref, Condition condition) const {
+		for (std::size_t j = predecessor(descend(data, true)); j != 0; j = predecessor(j)) {
+			if (condition(_base[j - 1])) {
+				ref = _base[j - 1];
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	template <typename T, typename Compare>
+	template <typename Condition>
+	bool gAVLFrozen<T, Compare>::search_after(const T& data, T& ref, Condition condition) const {
+		for (std::size_t j = descend(data, false); j != 0; j = successor(j)) {
+			if (condition(_base[j - 1])) {
+				ref = _base[j - 1];
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	template <typename T, typename Compare>
+	std::vector<T> gAVLFrozen<T, Compare>::to_stl_vector() const {
+		return std::vector<T>(begin(), end());
+	}
+
+	template <typename T, typename Compare>
+	bool gAVLFrozen<T, Compare>::save(std::ostream& out) const {
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be saved as they are in memory");
+
+		ImageHeader header;
+		char padding[image_offset - sizeof(ImageHeader)] = {};
+
+		std::memcpy(header._magic, "gAVL", 4);
+		header._version = image_version;
+		header._value_size = sizeof(T);
+		header._byte_order = image_byte_order;
+		header._count = _count;
+		header._offset = image_offset;
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(padding, sizeof(padding));
+		out.write(reinterpret_cast<const char*>(_base), static_cast<std::streamsize>(_count * sizeof(T)));
+
+		return static_cast<bool>(out);
+	}
+
+	template <typename T, typename Compare>
+	bool gAVLFrozen<T, Compare>::load(std::istream& in) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be loaded as they are in memory");
+
+		ImageHeader header;
+		char padding[image_offset - sizeof(ImageHeader)];
+
+		reset();
+
+		if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || !valid_header(header) || !in.read(padding, sizeof(padding))) {
+			return false;
+		}
+
+		// Read in chunks, so a damaged count runs into the end of the stream before it can exhaust memory
+		const std::size_t chunk = 4096;
+		std::size_t n = static_cast<std::size_t>(header._count);
+
+		while (_values.size() < n) {
+			std::size_t m = std::min(chunk, n - _values.size());
+			std::size_t k = _values.size();
+
+			_values.resize(k + m);
+
+			if (!in.read(reinterpret_cast<char*>(_values.data() + k), static_cast<std::streamsize>(m * sizeof(T)))) {
+				reset();
+				return false;
+			}
+		}
+
+		_base = _values.data();
+		_count = n;
+
+		return true;
+	}
+
+	template <typename T, typename Compare>
+	bool gAVLFrozen<T, Compare>::view(const void* image, std::size_t bytes) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be used as they are in memory");
+
+		ImageHeader header;
+
+		reset();
+
+		if (image == nullptr || bytes < image_offset) {
+			return false;
+		}
+
+		std::memcpy(&header, image, sizeof(header));
+
+		if (!valid_header(header) || header._count > (bytes - image_offset) / sizeof(T)) {
+			return false;
+		}
+
+		const char* values = static_cast<const char*>(image) + image_offset;
+
+		if (reinterpret_cast<std::uintptr_t>(values) % std::alignment_of<T>::value != 0) {
+			return false;
+		}
+
+		_base = reinterpret_cast<const T*>(values);
+		_count = static_cast<std::size_t>(header._count);
+
+		return true;
+	}
+
+	template <typename T, typename Compare>
+	bool gAVLFrozen<T, Compare>::valid_header(const ImageHeader& header) const {
+		return std::memcmp(header._magic, "gAVL", 4) == 0 && header._version == image_version && header._value_size == sizeof(T) &&
+			header._byte_order == image_byte_order && header._offset == image_offset && header._count <= std::numeric_limits<std::size_t>::max() / sizeof(T);
+	}
+
+	template <typename T, typename Compare>
+	void gAVLFrozen<T, Compare>::reset() {
+		std::vector<T>().swap(_values);
+		_base = nullptr;
+		_count = 0;
+	}
+
+	template <typename T, typename Compare>
+	typename gAVLFrozen<T, Compare>::const_iterator gAVLFrozen<T, Compare>::begin() const {
+		return const_iterator(successor(0), this);
+	}
+
+	template <typename T, typename Compare>
+	typename gAVLFrozen<T, Compare>::const_iterator gAVLFrozen<T, Compare>::end() const {
+		return const_iterator(0, this);
+	}
+
+	template <typename T, typename Compare>
+	typename gAVLFrozen<T, Compare>::const_iterator gAVLFrozen<T, Compare>::lower_bound(const T& data) const {
+		return const_iterator(descend(data, true), this);
+	}
+
+	template <typename T, typename Compare>
+	typename gAVLFrozen<T, Compare>::const_iterator gAVLFrozen<T, Compare>::upper_bound(const T& data) const {
+		return const_iterator(descend(data, false), this);
+	}
+
+	template <typename T, typename Compare>
+	template <typename K, typename C, typename>
+	typename gAVLFrozen<T, Compare>::const_iterator gAVLFrozen<T, Compare>::lower_bound(const K& key) const {
+		return const_iterator(descend(key, true), this);
+	}
+
+	template <typename T, typename Compare>
+	template <typename K, typename C, typename>
+	typename gAVLFrozen<T, Compare>::const_iterator gAVLFrozen<T, Compare>::upper_bound(const K& key) const {
+		return const_iterator(descend(key, false), this);
+	}
+
+	template <typename T, typename Compare>
+	template <typename K>
+	std::size_t gAVLFrozen<T, Compare>::descend(const K& key, bool inclusive) const {
+		// The comparison only picks the next index, it is never branched on
+		std::size_t n = _count;
+		std::size_t k = 1;
+		int threshold = inclusive ? 0 : -1;
+
+		while (k <= n) {
+			prefetch(k * prefetch_stride);
+			k = 2 * k + static_cast<std::size_t>(_comparator(key, _base[k - 1]) > threshold);
+		}
+
+		// k went right (a 1 bit) past every value before key, and left (a 0 bit) at the answer: drop the trailing 1s and that 0
+		while ((k & 1) == 1) {
+			k >>= 1;
+		}
+
+		return k >> 1;
+	}
+
+	template <typename T, typename Compare>
+	std::size_t gAVLFrozen<T, Compare>::successor(std::size_t k) const {
+		// Leftmost of the right subtree, if there is one, otherwise the first ancestor k is left of; successor(0) is the first position
+		std::size_t n = _count;
+
+		if (k == 0) {
+			k = 1;
+
+			if (k > n) {
+				return 0;
+			}
+
+			while (2 * k <= n) {
+				k = 2 * k;
+			}
+
+			return k;
+		}
+
+		if (2 * k + 1 <= n) {
+			k = 2 * k + 1;
+
+			while (2 * k <= n) {
+				k = 2 * k;
+			}
+
+			return k;
+		}
+
+		while ((k & 1) == 1) {
+			k >>= 1;
+		}
+
+		return k >> 1;
+	}
+
+	template <typename T, typename Compare>
+	std::size_t gAVLFrozen<T, Compare>::predecessor(std::size_t k) const {
+		std::size_t n = _count;
+
+		if (k == 0) {
+			k = 1;
+
+			if (k > n) {
+				return 0;
+			}
+
+			while (2 * k + 1 <= n) {
+				k = 2 * k + 1;
+			}
+
+			return k;
+		}
+
+		if (2 * k <= n) {
+			k = 2 * k;
+
+			while (2 * k + 1 <= n) {
+				k = 2 * k + 1;
+			}
+
+			return k;
+		}
+
+		while (k > 1 && (k & 1) == 0) {
+			k >>= 1;
+		}
+
+		return k >> 1;
+	}
+
+	template <typename T, typename Compare>
+	void gAVLFrozen<T, Compare>::prefetch(std::size_t k) const {
+#if defined(__GNUC__) || defined(__clang__)
+		if (k <= _count) {
+			__builtin_prefetch(_base + (k - 1));
+		}
+#else
+		(void)k;
+#endif
+	}
+
+	// A self-balancing binary search tree implementing AVL tree -- Space O(n)
+	// https://en.wikipedia.org/wiki/AVL_tree
+	// Compare is any callable int(const T&, const T&) -- a function object type lets the compiler inline every comparison,
+	// std::function<int(const T&, const T&)> still works if the comparator has to be chosen at runtime
+	// Heterogeneous lookups (the overloads taking a key K rather than a T) are only offered when Compare declares is_transparent,
+	// and then it must be callable as comparator(key, data) with data a const T&
+	// Augment is one of the augmentation policies above (gAVLNoAugment by default), Stats one of the statistics policies (gAVLNoStats by default)
+	template <typename T, typename Compare = gAVLCompare<T>, typename Allocator = std::allocator<T>, typename Augment = gAVLNoAugment, typename Stats = gAVLNoStats>
+	class gAVL {
+		public:
+			typedef Compare comparator_type;
+			typedef Allocator allocator_type;
+
+			explicit gAVL(const Compare& comparator = Compare(), const Allocator& allocator = Allocator());
+			template <typename InputIt> gAVL(InputIt first, InputIt last, const Compare& comparator = Compare(), const Allocator& allocator = Allocator());	// Builds the tree from [first, last), see assign()
+			gAVL(const gAVL& other);
+			gAVL(gAVL&& other);
+			~gAVL();
+
+			gAVL& operator=(const gAVL& other);
+			gAVL& operator=(gAVL&& other);
+
+			enum class Position : int {
+				Before,
+				After,
+				Equal
+			};
+
+			// Read-only, bidirectional, in-order position of a value within the tree (values can't be modified in place, that could break the ordering)
+			// Steps follow the parent links, so a full walk is O(n) and a single step O(1) amortized [O(log(n)) worst case]
+			// Stays valid until the value it points at is removed
+			class const_iterator {
+				public:
+					typedef std::bidirectional_iterator_tag iterator_category;
+					typedef T value_type;
+					typedef std::ptrdiff_t difference_type;
+					typedef const T& reference;
+					typedef const T* pointer;
+
+					const_iterator() : _node(nullptr), _tree(nullptr) {}
+
+					reference operator*() const { return _node->_data; }
+					pointer operator->() const { return &_node->_data; }
+
+					const_iterator& operator++() {
+						_node = successor(_node);
+						return *this;
+					}
+
+					const_iterator operator++(int) {
+						const_iterator it = *this;
+						++(*this);
+						return it;
+					}
+
+					const_iterator& operator--() {
+						// Stepping back from end() lands on the "most" value
+						_node = (_node == nullptr) ? rightmost(_tree->_root) : predecessor(_node);
+						return *this;
+					}
+
+					const_iterator operator--(int) {
+						const_iterator it = *this;
+						--(*this);
+						return it;
+					}
+
+					bool operator==(const const_iterator& other) const { return _node == other._node; }
+					bool operator!=(const const_iterator& other) const { return _node != other._node; }
+
+				protected:
+					friend class gAVL;
+
+					const_iterator(const gAVLNode<T, Augment>* node, const gAVL* tree) : _node(node), _tree(tree) {}
+
+					const gAVLNode<T, Augment>* _node;	// nullptr is end()
+					const gAVL* _tree;
+			};
+
+			typedef const_iterator iterator;
+			typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+			typedef const_reverse_iterator reverse_iterator;
+
+			bool insert(const T& data);				// Adds the data value to the tree (if it already exists in the tree, does nothing) [O(log(n))]
+			bool insert(T&& data);					// Same as above, moving data into the tree instead of copying it [O(log(n))]
+			template <typename... Args> std::pair<const_iterator, bool> emplace(Args&&... args);	// Builds the value in place from args and adds it, returns its position and true, or the position of the equal value already in the tree and false [O(log(n))]
+			std::pair<const_iterator, bool> insert_hint(const_iterator hint, const T& data);	// Same as emplace, looking for the slot from hint outwards instead of from the root [O(log(d)) amortized, d being the number of values between hint and data]
+			std::pair<const_iterator, bool> insert_hint(const_iterator hint, T&& data);
+			bool remove(const T& data);				// Removes the data value from the tree (if it does not exist in the tree does nothing) [O(log(n))]
+
+			std::size_t size();						// Returns the number of items stored in the tree [O(1)]
+			int height();							// Returns the height of the tree [O(1)]
+			std::tuple<int, int> height_bounds();	// Returns the theoretical upper and lower bounds of the AVL tree [O(1)]
+			bool contains(const T& data);			// Returns true if the data value is contained in the tree, false otherwise [O(log(n))]
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> bool contains(const K& key);	// Same as above, probing with any key the (transparent) comparator can compare against T [O(log(n))]
+			template <typename RandomIt, typename OutputIt> OutputIt contains_batch(RandomIt first, RandomIt last, OutputIt result) const;	// Writes whether the tree contains each key of [first, last) to result, in order, overlapping the cache misses of several lookups at once [O(m log(n))]
+			template <typename InputIt> std::size_t insert_batch(InputIt first, InputIt last);	// Inserts every value of [first, last) (the first of several equal values wins), returns how many were new [O(m log(n + m))]
+			bool parent(const T& data, T& ref);		// Returns the parent of data within the tree if it exists, otherwise returns false and doesn't alter ref [O(log(n))]
+			template <typename Condition = gAVLAlways> bool search_neighbors(const T& data, std::map<Position,T>& ref, Condition condition = Condition()); // Return the insertion neighborhood of data (what it would be adjacent to if you did insert it). --> Worst case O(n), typically far better
+			template <typename Condition = gAVLAlways> bool search_before(const T& data, T& ref, Condition condition = Condition());	// Worst case [O(n)], typically far better
+			template <typename Condition = gAVLAlways> bool search_after(const T& data, T& ref, Condition condition = Condition()); // Worst case [O(n)], typically far better
+			template <typename K, typename Condition = gAVLAlways, typename C = Compare, typename = typename C::is_transparent> bool search_neighbors(const K& key, std::map<Position,T>& ref, Condition condition = Condition());
+			template <typename K, typename Condition = gAVLAlways, typename C = Compare, typename = typename C::is_transparent> bool search_before(const K& key, T& ref, Condition condition = Condition());
+			template <typename K, typename Condition = gAVLAlways, typename C = Compare, typename = typename C::is_transparent> bool search_after(const K& key, T& ref, Condition condition = Condition());
+
+			// Same as the three above, skipping every subtree whose summary fails subtree_condition -- requires gAVLSummaryAugment
+			// subtree_condition(summary) must hold whenever some value in the subtree could satisfy condition
+			// If it holds exactly when one does, the search is [O(log(n))] whatever the condition rejects
+			template <typename Condition, typename SubtreeCondition> bool search_neighbors(const T& data, std::map<Position,T>& ref, Condition condition, SubtreeCondition subtree_condition);
+			template <typename Condition, typename SubtreeCondition> bool search_before(const T& data, T& ref, Condition condition, SubtreeCondition subtree_condition);
+			template <typename Condition, typename SubtreeCondition> bool search_after(const T& data, T& ref, Condition condition, SubtreeCondition subtree_condition);
+			template <typename K, typename Condition, typename SubtreeCondition, typename C = Compare, typename = typename C::is_transparent> bool search_neighbors(const K& key, std::map<Position,T>& ref, Condition condition, SubtreeCondition subtree_condition);
+			template <typename K, typename Condition, typename SubtreeCondition, typename C = Compare, typename = typename C::is_transparent> bool search_before(const K& key, T& ref, Condition condition, SubtreeCondition subtree_condition);
+			template <typename K, typename Condition, typename SubtreeCondition, typename C = Compare, typename = typename C::is_transparent> bool search_after(const K& key, T& ref, Condition condition, SubtreeCondition subtree_condition);
+
+			std::vector<T> to_stl_vector();			// Returns the tree as an ordered vector, with the comparator "least" (negative to all others) value first, and the comparator "most" (positive to all others) last [O(n)]
+			void to_stl_vector(std::vector<T>& out);	// Same as above into out, replacing its contents -- reusing its capacity allocates nothing, if that already holds size() values [O(n)]
+			template <typename Visitor> void for_each(Visitor visitor) const;	// Calls visitor(value) on every value in comparator order, without allocating [O(n)]
+			template <typename Visitor> void for_each_range(const T& lo, const T& hi, Visitor visitor) const;	// Same, for the values in [lo, hi] [O(log(n) + k) for the k values visited]
+			template <typename K, typename Visitor, typename C = Compare, typename = typename C::is_transparent> void for_each_range(const K& lo, const K& hi, Visitor visitor) const;
+			bool root(T& data);
+			bool search(const T& search_data, T& found_data);
+
+			const_iterator begin() const;			// Position of the comparator "least" value [O(log(n))]
+			const_iterator end() const;				// Position past the comparator "most" value [O(1)]
+			const_iterator cbegin() const;
+			const_iterator cend() const;
+			const_reverse_iterator rbegin() const;	// Walks from the comparator "most" value down [O(log(n))]
+			const_reverse_iterator rend() const;
+			const_reverse_iterator crbegin() const;
+			const_reverse_iterator crend() const;
+			const_iterator select(std::size_t k) const;	// Position of the k-th value (0 based, in comparator order), or end() if k >= size() -- requires gAVLCountAugment [O(log(n))]
+			std::size_t rank(const T& data) const;	// Number of values before data -- requires gAVLCountAugment [O(log(n))]
+			std::size_t count_range(const T& lo, const T& hi) const;	// Number of values in [lo, hi] -- requires gAVLCountAugment [O(log(n))]
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> std::size_t rank(const K& key) const;
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> std::size_t count_range(const K& lo, const K& hi) const;
+			template <typename E, typename Visitor> void overlapping(const E& a, const E& b, Visitor visitor) const;	// Calls visitor(value) on every interval overlapping [a, b], in comparator order -- requires gAVLIntervalAugment [O(log(n) + k log(n / k)) for the k intervals visited]
+			template <typename E> bool any_overlap(const E& a, const E& b) const;	// Returns true if some interval overlaps [a, b] -- requires gAVLIntervalAugment [O(log(n))]
+			template <typename E> bool any_overlap(const E& a, const E& b, T& ref) const;	// Same as above, copying that interval to ref (ref is left alone if there is none) [O(log(n))]
+			const_iterator lower_bound(const T& data) const;	// Position of the first value not before data, or end() [O(log(n))]
+			const_iterator upper_bound(const T& data) const;	// Position of the first value after data, or end() [O(log(n))]
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> const_iterator lower_bound(const K& key) const;
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> const_iterator upper_bound(const K& key) const;
+			const_iterator lower_bound(const_iterator finger, const T& data) const;	// Same as lower_bound(data), searching from finger outwards [O(log(d)) amortized, d being the number of values between finger and data]
+			const_iterator upper_bound(const_iterator finger, const T& data) const;	// Same as upper_bound(data) (the value search_after finds), searching from finger outwards [O(log(d)) amortized]
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> bool search(const K& search_key, T& found_data);
+			void clear();							// Removes every item from the tree [O(n)]
+			template <typename InputIt> void assign(InputIt first, InputIt last);	// Replaces the contents with the values of [first, last) (the first of several equal values wins), building a perfectly balanced tree bottom-up [O(n) if already in comparator order, O(n log(n)) otherwise]
+			bool join(gAVL& right);					// Moves every value of right into the tree, if all of them come after every value of the tree (otherwise returns false and changes nothing) [O(log(n))]
+			gAVL split(const T& data);				// Moves every value not before data into the returned tree [O(log(n)) with gAVLCountAugment, O(log(n) + k) for the k values moved otherwise]
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> gAVL split(const K& key);
+			std::size_t erase_range(const T& lo, const T& hi);	// Removes every value in [lo, hi] at once, returns how many there were [O(log(n) + k) for the k values removed]
+			gAVL extract_range(const T& lo, const T& hi);	// Moves every value in [lo, hi] into the returned tree [O(log(n)) with gAVLCountAugment, O(log(n) + k) otherwise]
+			template <typename OutputIt> OutputIt extract_range(const T& lo, const T& hi, OutputIt result);	// Moves every value in [lo, hi] out to result, in order, and removes them [O(log(n) + k)]
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> std::size_t erase_range(const K& lo, const K& hi);
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> gAVL extract_range(const K& lo, const K& hi);
+			void union_with(gAVL other);			// Adds every value of other, if equal values exist in both the tree keeps its own -- pass std::move(other) to hand over its nodes instead of copying them [O(m log(n/m + 1))]
+			void intersect_with(gAVL other);		// Keeps only the values that also exist in other [O(m log(n/m + 1))]
+			void difference(gAVL other);			// Removes every value that exists in other [O(m log(n/m + 1))]
+
+			// Fork-join versions of the bulk operations, splitting the work into subtrees run through pool.fork_join(f, g) (see gAVLTaskPool in gAVLParallel.h)
+			// Nodes are only allocated/freed concurrently if gAVLConcurrentAllocator<Allocator> holds, and the comparator has to be safe to call from several threads at once
+			template <typename Pool> std::vector<T> to_stl_vector(Pool& pool);	// T has to be default constructible [O(n / p + log(n))]
+			template <typename Pool> void clear(Pool& pool);
+			template <typename RandomIt, typename Pool> void assign(RandomIt first, RandomIt last, Pool& pool);	// [O(n / p + log(n)) if already in comparator order, otherwise same as assign(first, last)]
+			template <typename Pool> void union_with(gAVL other, Pool& pool);
+			template <typename Pool> void intersect_with(gAVL other, Pool& pool);
+			template <typename Pool> void difference(gAVL other, Pool& pool);
+			allocator_type get_allocator() const;
+			gAVLFrozen<T, Compare> freeze() const;	// Immutable, flat copy of the tree for read-only use [O(n)]
+			bool save(std::ostream& out) const;		// Writes the values as an image gAVLFrozen can load or view in place (see there) -- T has to be trivially copyable, returns false if out failed [O(n)]
+			bool load(std::istream& in);			// Replaces the contents with the values of an image read from in, built bottom-up, returns false (and changes nothing) if it isn't a valid one [O(n)]
+			gAVLCounters stats() const;				// What the tree did so far, all zero unless Stats counts it (see gAVLStats) [O(1)]
+			void reset_stats();						// Starts the counts over [O(1)]
+
+		protected:
+			typedef typename std::allocator_traits<Allocator>::template rebind_alloc<gAVLNode<T, Augment>> node_allocator_type;
+			typedef std::allocator_traits<node_allocator_type> node_traits;
+			typedef gAVLLinks<gAVLNode<T, Augment>, Augment> link_traits;
+
+			template <typename... Args> gAVLNode<T, Augment>* create_node(Args&&... args);
+			void destroy_node(gAVLNode<T, Augment>* node);
+			template <typename A, typename B> int compare(const A& a, const B& b) const;	// _comparator(a, b), counted
+			template <typename Condition> bool test(Condition& condition, const T& data) const;	// condition(data), counted as a scan visit
+
+			template <typename K> gAVLNode<T, Augment>* find(const K& data);
+			template <typename K> gAVLNode<T, Augment>* lower_node(const K& key) const;
+			template <typename K> gAVLNode<T, Augment>* upper_node(const K& key) const;
+			template <typename K> std::size_t rank_node(const K& key, bool inclusive) const;
+			static std::size_t count(const gAVLNode<T, Augment>* node);
+			void update_path(gAVLNode<T, Augment>* node);
+			template <typename Node> static Node* leftmost(Node* node);
+			template <typename Node> static Node* rightmost(Node* node);
+			template <typename Node> static Node* successor(Node* node);
+			template <typename Node> static Node* predecessor(Node* node);
+			template <typename K, typename Condition, typename Gate> gAVLNode<T, Augment>* find_before(const K& data, Condition& condition, Gate& gate) const;
+			template <typename K, typename Condition, typename Gate> gAVLNode<T, Augment>* find_after(const K& data, Condition& condition, Gate& gate) const;
+			template <typename K, typename Condition, typename Gate> bool find_neighbors(const K& data, std::map<Position,T>& ref, Condition& condition, Gate& gate) const;
+			template <typename Condition, typename Gate> gAVLNode<T, Augment>* before_slot(gAVLNode<T, Augment>* q, int comp, Condition& condition, Gate& gate) const;
+			template <typename Condition, typename Gate> gAVLNode<T, Augment>* after_slot(gAVLNode<T, Augment>* q, int comp, Condition& condition, Gate& gate) const;
+			template <typename Condition, typename Gate> gAVLNode<T, Augment>* last_match(gAVLNode<T, Augment>* root, Condition& condition, Gate& gate) const;
+			template <typename Condition, typename Gate> gAVLNode<T, Augment>* first_match(gAVLNode<T, Augment>* root, Condition& condition, Gate& gate) const;
+			gAVLNode<T, Augment>* clone(const gAVLNode<T, Augment>* root);
+			template <typename K, typename... Args> std::pair<gAVLNode<T, Augment>*, bool> insert_unique(const K& key, Args&&... args);
+			template <typename K> gAVLNode<T, Augment>* find_slot(const K& key, int& comp) const;
+			template <typename K> gAVLNode<T, Augment>* find_slot(gAVLNode<T, Augment>* p, const K& key, int& comp) const;	// Same, descending from p
+			template <typename K> gAVLNode<T, Augment>* finger_slot(const gAVLNode<T, Augment>* finger, const K& key, int& comp) const;	// Same, climbing from finger (nullptr is end()) only as far as needed
+			template <typename V> std::pair<const_iterator, bool> insert_hinted(const gAVLNode<T, Augment>* hint, V&& data);
+			const_iterator position(const gAVLNode<T, Augment>* node) const;	// Iterator to node, for subclasses (which can't reach const_iterator's constructor)
+			static const gAVLNode<T, Augment>* position_node(const_iterator it);	// Node an iterator points at (nullptr for end())
+			void link_node(gAVLNode<T, Augment>* p, int comp, gAVLNode<T, Augment>* node);
+			void erase_node(gAVLNode<T, Augment>* q);
+			bool unlink_node(gAVLNode<T, Augment>* q);		// Detaches q without freeing it, returns true if the height of the whole tree shrank by one
+			std::size_t destroy_subtree(gAVLNode<T, Augment>* root);
+			gAVLNode<T, Augment>* adopt(gAVL& other);
+			static int child_height(const gAVLNode<T, Augment>* node, int height, bool left);
+			std::size_t subtree_size(const gAVLNode<T, Augment>* node) const;
+			std::size_t subtree_size(const gAVLNode<T, Augment>* node, std::true_type) const;
+			std::size_t subtree_size(const gAVLNode<T, Augment>* node, std::false_type) const;
+			gAVLNode<T, Augment>* join(gAVLNode<T, Augment>* L, int hL, gAVLNode<T, Augment>* k, gAVLNode<T, Augment>* R, int hR, int& h);
+			gAVLNode<T, Augment>* join(gAVLNode<T, Augment>* L, int hL, gAVLNode<T, Augment>* R, int hR, int& h);
+			template <typename K> gAVLNode<T, Augment>* split(gAVLNode<T, Augment>* root, int h, const K& key, gAVLNode<T, Augment>*& L, int& hL, gAVLNode<T, Augment>*& R, int& hR);
+			gAVLNode<T, Augment>* unite(gAVLNode<T, Augment>* a, int ha, gAVLNode<T, Augment>* b, int hb, int& h);
+			gAVLNode<T, Augment>* intersect(gAVLNode<T, Augment>* a, int ha, gAVLNode<T, Augment>* b, int hb, int& h);
+			gAVLNode<T, Augment>* subtract(gAVLNode<T, Augment>* a, int ha, gAVLNode<T, Augment>* b, int hb, int& h);
+			template <typename K> gAVL split_tree(const K& key);
+			template <typename K> gAVLNode<T, Augment>* detach_range(const K& lo, const K& hi, int& height);	// Cuts the values in [lo, hi] out as a subtree of their own (of height height), leaving _size to the caller
+			template <typename K> std::size_t erase_values(const K& lo, const K& hi);
+			template <typename K> gAVL extract_tree(const K& lo, const K& hi);
+
+			static const std::size_t batch_width = 16;	// Lookups contains_batch interleaves
+			static void prefetch(const gAVLNode<T, Augment>* node);
+
+			enum SetOperation { Unite, Intersect, Subtract };
+			static const int parallel_grain = 14;	// Subtrees no higher than this are left to a single task
+
+			template <typename Node, typename F> static void walk(Node* root, F& f);
+			template <typename K, typename Visitor> void visit_range(const K& lo, const K& hi, Visitor& visitor) const;
+			template <typename E> const gAVLNode<T, Augment>* find_overlap(const E& a, const E& b) const;
+			void pieces(gAVLNode<T, Augment>* node, int h, std::vector<std::pair<gAVLNode<T, Augment>*, bool>>& out);
+			template <typename Pool, typename F> static void parallel_for(Pool& pool, std::size_t begin, std::size_t end, F& f);
+			template <typename Pool> gAVLNode<T, Augment>* build(gAVLNode<T, Augment>* const* nodes, std::size_t n, gAVLNode<T, Augment>* parent, Pool& pool);
+			gAVLNode<T, Augment>* set_operation(SetOperation op, gAVLNode<T, Augment>* a, int ha, gAVLNode<T, Augment>* b, int hb, int& h);
+			template <typename Pool> gAVLNode<T, Augment>* set_operation(SetOperation op, gAVLNode<T, Augment>* a, int ha, gAVLNode<T, Augment>* b, int hb, int& h, Pool& pool);
+			template <typename Pool> void set_operation(SetOperation op, gAVL& other, Pool& pool);
+			void swap_with_successor(gAVLNode<T, Augment>* q, gAVLNode<T, Augment>* s);
+			gAVLNode<T, Augment>* build(gAVLNode<T, Augment>* const* nodes, std::size_t n, gAVLNode<T, Augment>* parent);
+			static int build_height(std::size_t n);
+			bool retrace_insert(gAVLNode<T, Augment>* node);	// Returns true if the height of the whole tree grew by one
+			bool retrace_remove(gAVLNode<T, Augment>* node);	// Returns true if the height of the whole tree shrank by one
+			gAVLNode<T, Augment>* rotate_right(gAVLNode<T, Augment>* A, gAVLNode<T, Augment>* B);
+			gAVLNode<T, Augment>* rotate_left(gAVLNode<T, Augment>* A, gAVLNode<T, Augment>* B);
+			gAVLNode<T, Augment>* rotate_right_left(gAVLNode<T, Augment>* A, gAVLNode<T, Augment>* B);
+			gAVLNode<T, Augment>* rotate_left_right(gAVLNode<T, Augment>* A, gAVLNode<T, Augment>* B);
+
+			Compare _comparator;
+			mutable Stats _stats;					// Next to _comparator, which leaves room for an empty one in the padding before _root
+			typename link_traits::type _root;
+			std::size_t _size;
+			int _height;							// Height of the whole tree, kept up to date by every operation that reshapes it
+			node_allocator_type _allocator;
+	};
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVL<T, Compare, Allocator, Augment, Stats>::gAVL(const Compare& comparator, const Allocator& allocator): _comparator(comparator), _root(nullptr), _size(0), _height(0), _allocator(allocator) {
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename InputIt>
+	gAVL<T, Compare, Allocator, Augment, Stats>::gAVL(InputIt first, InputIt last, const Compare& comparator, const Allocator& allocator): _comparator(comparator), _root(nullptr), _size(0), _height(0), _allocator(allocator) {
+		assign(first, last);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVL<T, Compare, Allocator, Augment, Stats>::gAVL(const gAVL& other): _comparator(other._comparator), _root(nullptr), _size(0), _height(0), _allocator(node_traits::select_on_container_copy_construction(other._allocator)) {
+		_root = clone(other._root);
+		_size = other._size;
+		_height = other._height;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVL<T, Compare, Allocator, Augment, Stats>::gAVL(gAVL&& other): _comparator(std::move(other._comparator)), _root(other._root), _size(other._size), _height(other._height), _allocator(std::move(other._allocator)) {
+		other._root = nullptr;
+		other._size = 0;
+		other._height = 0;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVL<T, Compare, Allocator, Augment, Stats>::~gAVL() {
+		clear();
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVL<T, Compare, Allocator, Augment, Stats>& gAVL<T, Compare, Allocator, Augment, Stats>::operator=(const gAVL& other) {
+		if (this != &other) {
+			gAVL tmp(other);
+			*this = std::move(tmp);
+		}
+
+		return *this;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVL<T, Compare, Allocator, Augment, Stats>& gAVL<T, Compare, Allocator, Augment, Stats>::operator=(gAVL&& other) {
+		if (this != &other) {
+			clear();
+
+			_comparator = std::move(other._comparator);
+			_allocator = std::move(other._allocator);
+			_root = other._root;
+			_size = other._size;
+			_height = other._height;
+
+			other._root = nullptr;
+			other._size = 0;
+			other._height = 0;
+		}
+
+		return *this;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::clear() {
+		destroy_subtree(_root);
+
+		_root = nullptr;
+		_size = 0;
+		_height = 0;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::destroy_subtree(gAVLNode<T, Augment>* root) {
+		// Post-order walk over the parent links, freeing each node once both of its subtrees are gone
+		gAVLNode<T, Augment>* p = root;
+		std::size_t n = 0;
+
+		while (p != nullptr) {
+			if (p->_left != nullptr) {
+				p = p->_left;
+			} else if (p->_right != nullptr) {
+				p = p->_right;
+			} else {
+				// Don't climb out of the subtree, root may still be linked to a parent
+				gAVLNode<T, Augment>* q = (p == root) ? nullptr : static_cast<gAVLNode<T, Augment>*>(p->_parent);
+
+				if (q != nullptr) {
+					if (q->_left == p) {
+						q->_left = nullptr;
+					} else {
+						q->_right = nullptr;
+					}
+				}
+
+				destroy_node(p);
+				p = q;
+				n++;
+			}
+		}
+
+		return n;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename InputIt>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::assign(InputIt first, InputIt last) {
+		// Build every node up front, in input order, dropping values equal to the one kept right before them
+		std::vector<gAVLNode<T, Augment>*> nodes;
+		bool sorted = true;
+
+		if (std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>::value) {
+			nodes.reserve(static_cast<std::size_t>(std::distance(first, last)));
+		}
+
+		try {
+			for (; first != last; ++first) {
+				gAVLNode<T, Augment>* node = create_node(*first);
+
+				if (!nodes.empty()) {
+					int comp = compare(node->_data, nodes.back()->_data);
+
+					if (comp == 0) {
+						destroy_node(node);
+						continue;
+					} else if (comp < 0) {
+						sorted = false;
+					}
+				}
+
+				nodes.push_back(node);
+			}
+
+			if (!sorted) {
+				// Stable, so the first of several equal values is the one kept
+				std::stable_sort(nodes.begin(), nodes.end(), [this](const gAVLNode<T, Augment>* a, const gAVLNode<T, Augment>* b) -> bool {
+					return compare(a->_data, b->_data) < 0;
+				});
+
+				std::size_t kept = 0;
+
+				for (std::size_t i = 0; i < nodes.size(); ++i) {
+					if (kept > 0 && compare(nodes[i]->_data, nodes[kept - 1]->_data) == 0) {
+						destroy_node(nodes[i]);
+					} else {
+						nodes[kept++] = nodes[i];
+					}
+				}
+
+				nodes.resize(kept);
+			}
+		} catch (...) {
+			for (gAVLNode<T, Augment>* node : nodes) {
+				destroy_node(node);
+			}
+
+			throw;
+		}
+
+		clear();
+
+		_root = build(nodes.data(), nodes.size(), nullptr);
+		_size = nodes.size();
+		_height = build_height(_size);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::join(gAVL& right) {
+		if (this == &right || right._root == nullptr) {
+			return this != &right;
+		}
+
+		if (_root != nullptr && compare(rightmost(_root)->_data, leftmost(right._root)->_data) >= 0) {
+			return false;
+		}
+
+		std::size_t n = right._size;
+		int hL = _height;
+		int hR = right._height;
+		gAVLNode<T, Augment>* L = _root;
+		gAVLNode<T, Augment>* R = adopt(right);
+
+		// The first value of right joins the two
+		_root = R;
+		gAVLNode<T, Augment>* k = leftmost(R);
+
+		if (unlink_node(k)) {
+			hR--;
+		}
+
+		_root = join(L, hL, k, _root, hR, _height);
+		_size += n;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVL<T, Compare, Allocator, Augment, Stats> gAVL<T, Compare, Allocator, Augment, Stats>::split(const T& data) {
+		return split_tree(data);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename C, typename>
+	gAVL<T, Compare, Allocator, Augment, Stats> gAVL<T, Compare, Allocator, Augment, Stats>::split(const K& key) {
+		return split_tree(key);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K>
+	gAVL<T, Compare, Allocator, Augment, Stats> gAVL<T, Compare, Allocator, Augment, Stats>::split_tree(const K& key) {
+		gAVL right(_comparator, get_allocator());
+
+		if (_root == nullptr) {
+			return right;
+		}
+
+		gAVLNode<T, Augment>* L = nullptr;
+		gAVLNode<T, Augment>* R = nullptr;
+		int hL = 0;
+		int hR = 0;
+		gAVLNode<T, Augment>* found = split(_root, _height, key, L, hL, R, hR);
+
+		if (found != nullptr) {
+			// Not before data, so it goes along with the values after it
+			R = join(nullptr, 0, found, R, hR, hR);
+		}
+
+		std::size_t moved = subtree_size(R);
+
+		_root = L;
+		_size -= moved;
+		_height = hL;
+		right._root = R;
+		right._size = moved;
+		right._height = hR;
+
+		return right;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::erase_range(const T& lo, const T& hi) {
+		return erase_values(lo, hi);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVL<T, Compare, Allocator, Augment, Stats> gAVL<T, Compare, Allocator, Augment, Stats>::extract_range(const T& lo, const T& hi) {
+		return extract_tree(lo, hi);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename OutputIt>
+	OutputIt gAVL<T, Compare, Allocator, Augment, Stats>::extract_range(const T& lo, const T& hi, OutputIt result) {
+		int h = 0;
+		gAVLNode<T, Augment>* range = detach_range(lo, hi, h);
+
+		auto move_out = [&result](gAVLNode<T, Augment>* node) {
+			*result = std::move(node->_data);
+			++result;
+		};
+
+		try {
+			walk(range, move_out);
+		} catch (...) {
+			_size -= destroy_subtree(range);
+			throw;
+		}
+
+		_size -= destroy_subtree(range);
+
+		return result;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename C, typename>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::erase_range(const K& lo, const K& hi) {
+		return erase_values(lo, hi);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename C, typename>
+	gAVL<T, Compare, Allocator, Augment, Stats> gAVL<T, Compare, Allocator, Augment, Stats>::extract_range(const K& lo, const K& hi) {
+		return extract_tree(lo, hi);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::detach_range(const K& lo, const K& hi, int& height) {
+		height = 0;
+
+		if (_root == nullptr) {
+			return nullptr;
+		}
+
+		// Split off everything before lo, then everything after hi, and join the two outer parts back together
+		// If lo comes after hi, nothing lands between the two splits
+		gAVLNode<T, Augment>* L = nullptr;
+		gAVLNode<T, Augment>* M = nullptr;
+		gAVLNode<T, Augment>* R = nullptr;
+		int hL = 0;
+		int hM = 0;
+		int hR = 0;
+
+		gAVLNode<T, Augment>* found = split(_root, _height, lo, L, hL, M, hM);
+
+		if (found != nullptr) {
+			M = join(nullptr, 0, found, M, hM, hM);
+		}
+
+		gAVLNode<T, Augment>* range = nullptr;
+
+		found = split(M, hM, hi, range, height, R, hR);
+
+		if (found != nullptr) {
+			range = join(range, height, found, nullptr, 0, height);
+		}
+
+		_root = join(L, hL, R, hR, _height);
+
+		return range;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::erase_values(const K& lo, const K& hi) {
+		int h = 0;
+		std::size_t erased = destroy_subtree(detach_range(lo, hi, h));
+
+		_size -= erased;
+
+		return erased;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K>
+	gAVL<T, Compare, Allocator, Augment, Stats> gAVL<T, Compare, Allocator, Augment, Stats>::extract_tree(const K& lo, const K& hi) {
+		gAVL range(_comparator, get_allocator());
+
+		range._root = detach_range(lo, hi, range._height);
+		range._size = subtree_size(range._root);
+		_size -= range._size;
+
+		return range;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::union_with(gAVL other) {
+		std::size_t m = other._size;
+		int hb = other._height;
+		gAVLNode<T, Augment>* b = adopt(other);
+
+		_size += m;
+		_root = unite(_root, _height, b, hb, _height);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::intersect_with(gAVL other) {
+		std::size_t m = other._size;
+		int hb = other._height;
+		gAVLNode<T, Augment>* b = adopt(other);
+
+		_size += m;
+		_root = intersect(_root, _height, b, hb, _height);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::difference(gAVL other) {
+		std::size_t m = other._size;
+		int hb = other._height;
+		gAVLNode<T, Augment>* b = adopt(other);
+
+		_size += m;
+		_root = subtract(_root, _height, b, hb, _height);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Pool>
+	std::vector<T> gAVL<T, Compare, Allocator, Augment, Stats>::to_stl_vector(Pool& pool) {
+		std::vector<std::pair<gAVLNode<T, Augment>*, bool>> parts;
+		pieces(_root, _height, parts);
+
+		// Every piece is sized first, so each one knows where in the output it starts
+		std::vector<std::size_t> offsets(parts.size() + 1, 0);
+
+		auto measure = [&](std::size_t i) {
+			offsets[i + 1] = parts[i].second ? subtree_size(parts[i].first) : 1;
+		};
+
+		parallel_for(pool, 0, parts.size(), measure);
+
+		for (std::size_t i = 0; i < parts.size(); ++i) {
+			offsets[i + 1] += offsets[i];
+		}
+
+		std::vector<T> v(_size);
+
+		auto fill = [&](std::size_t i) {
+			if (parts[i].second) {
+				T* out = v.data() + offsets[i];
+				auto copy = [&out](const gAVLNode<T, Augment>* p) { *out++ = p->_data; };
+
+				walk(static_cast<const gAVLNode<T, Augment>*>(parts[i].first), copy);
+			} else {
+				v[offsets[i]] = parts[i].first->_data;
+			}
+		};
+
+		parallel_for(pool, 0, parts.size(), fill);
+
+		return v;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Pool>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::clear(Pool& pool) {
+		if (!gAVLConcurrentAllocator<Allocator>::value) {
+			clear();
+			return;
+		}
+
+		std::vector<std::pair<gAVLNode<T, Augment>*, bool>> parts;
+		pieces(_root, _height, parts);
+
+		// The whole subtrees go first, in parallel, which leaves only the few nodes that were above them
+		auto destroy = [&](std::size_t i) {
+			if (parts[i].second) {
+				destroy_subtree(parts[i].first);
+			}
+		};
+
+		parallel_for(pool, 0, parts.size(), destroy);
+
+		for (const std::pair<gAVLNode<T, Augment>*, bool>& part : parts) {
+			if (!part.second) {
+				destroy_node(part.first);
+			}
+		}
+
+		_root = nullptr;
+		_size = 0;
+		_height = 0;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename RandomIt, typename Pool>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::assign(RandomIt first, RandomIt last, Pool& pool) {
+		std::size_t n = static_cast<std::size_t>(last - first);
+
+		// Only input already in strict comparator order can be cut up freely, anything else takes the sequential path
+		std::size_t chunks = (n >> parallel_grain) + 1;
+		std::vector<char> ordered(chunks, 1);
+
+		auto check = [&](std::size_t c) {
+			std::size_t end = std::min(n, (c + 1) << parallel_grain);
+
+			for (std::size_t i = std::max<std::size_t>(c << parallel_grain, 1); i < end; ++i) {
+				if (compare(first[i - 1], first[i]) >= 0) {
+					ordered[c] = 0;
+					return;
+				}
+			}
+		};
+
+		parallel_for(pool, 0, chunks, check);
+
+		if (std::find(ordered.begin(), ordered.end(), 0) != ordered.end()) {
+			assign(first, last);
+			return;
+		}
+
+		std::vector<gAVLNode<T, Augment>*> nodes(n, nullptr);
+
+		auto create = [&](std::size_t c) {
+			std::size_t end = std::min(n, (c + 1) << parallel_grain);
+
+			for (std::size_t i = c << parallel_grain; i < end; ++i) {
+				nodes[i] = create_node(first[i]);
+			}
+		};
+
+		try {
+			if (gAVLConcurrentAllocator<Allocator>::value) {
+				parallel_for(pool, 0, chunks, create);
+			} else {
+				for (std::size_t c = 0; c < chunks; ++c) {
+					create(c);
+				}
+			}
+		} catch (...) {
+			for (gAVLNode<T, Augment>* node : nodes) {
+				if (node != nullptr) {
+					destroy_node(node);
+				}
+			}
+
+			throw;
+		}
+
+		clear(pool);
+
+		_root = build(nodes.data(), nodes.size(), nullptr, pool);
+		_size = nodes.size();
+		_height = build_height(_size);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Pool>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::union_with(gAVL other, Pool& pool) {
+		set_operation(Unite, other, pool);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Pool>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::intersect_with(gAVL other, Pool& pool) {
+		set_operation(Intersect, other, pool);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Pool>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::difference(gAVL other, Pool& pool) {
+		set_operation(Subtract, other, pool);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::insert(const T& data) {
+		return insert_unique(data, data).second;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::insert(T&& data) {
+		// data is only moved from once it is known not to be in the tree yet
+		return insert_unique(data, std::move(data)).second;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename... Args>
+	std::pair<typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator, bool> gAVL<T, Compare, Allocator, Augment, Stats>::emplace(Args&&... args) {
+		// The value has to exist before it can be compared, so the node is built up front and thrown away on a duplicate
+		gAVLNode<T, Augment>* node = create_node(std::forward<Args>(args)...);
+
+		int comp = 0;
+		gAVLNode<T, Augment>* p = find_slot(node->_data, comp);
+
+		if (p != nullptr && comp == 0) {
+			destroy_node(node);
+			return std::pair<const_iterator, bool>(const_iterator(p, this), false);
+		}
+
+		link_node(p, comp, node);
+
+		return std::pair<const_iterator, bool>(const_iterator(node, this), true);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	std::pair<typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator, bool> gAVL<T, Compare, Allocator, Augment, Stats>::insert_hint(const_iterator hint, const T& data) {
+		return insert_hinted(hint._node, data);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	std::pair<typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator, bool> gAVL<T, Compare, Allocator, Augment, Stats>::insert_hint(const_iterator hint, T&& data) {
+		return insert_hinted(hint._node, std::move(data));
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::remove(const T& data) {
+		gAVLNode<T, Augment>* q = find(data);
+
+		if (q == nullptr) {
+			return false;
+		}
+
+		erase_node(q);
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::size() {
+		return _size;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	int gAVL<T, Compare, Allocator, Augment, Stats>::height() {
+		return _height;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	std::tuple<int, int> gAVL<T, Compare, Allocator, Augment, Stats>::height_bounds() {
+		// Theoretical AVL tree height bounds, [lower, upper]
+		static const double phi = (1.0 + std::sqrt(5.0)) / 2.0;
+		static const double c   = 1.0 / std::log2(phi);
+		static const double b   = (c / 2.0) * std::log2(5) - 2.0;
+
+		double n = static_cast<double>(size());
+
+		return std::tuple<int, int>(
+			static_cast<int>(std::floor(std::log2(n + 1.0))),
+			static_cast<int>(std::ceil(c * std::log2(n + 2.0) + b)) - 1
+		);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::contains(const T& data) {
+		if (find(data) != nullptr) {
+			return true;
+		}
+
+		return false;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename C, typename>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::contains(const K& key) {
+		return find(key) != nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename RandomIt, typename OutputIt>
+	OutputIt gAVL<T, Compare, Allocator, Augment, Stats>::contains_batch(RandomIt first, RandomIt last, OutputIt result) const {
+		// A lone descent stalls on a cache miss at every level, so batch_width of them take turns instead: each round moves
+		// every one of them down a level and prefetches the node it lands on, which has arrived by the time its turn comes again
+		const gAVLNode<T, Augment>* at[batch_width];
+		bool found[batch_width];
+
+		while (first != last) {
+			std::size_t n = std::min<std::size_t>(batch_width, static_cast<std::size_t>(last - first));
+			std::size_t active = n;
+
+			for (std::size_t i = 0; i < n; ++i) {
+				at[i] = _root;
+				found[i] = false;
+			}
+
+			while (active > 0) {
+				active = 0;
+
+				for (std::size_t i = 0; i < n; ++i) {
+					const gAVLNode<T, Augment>* q = at[i];
+
+					if (q == nullptr) {
+						continue;
+					}
+
+					int comp = compare(first[i], q->_data);
+
+					if (comp == 0) {
+						found[i] = true;
+						q = nullptr;
+					} else {
+						q = (comp < 0) ? q->_left : q->_right;
+						prefetch(q);
+					}
+
+					at[i] = q;
+					active += (q != nullptr) ? 1 : 0;
+				}
+			}
+
+			for (std::size_t i = 0; i < n; ++i) {
+				*result = found[i];
+				++result;
+			}
+
+			first += static_cast<typename std::iterator_traits<RandomIt>::difference_type>(n);
+		}
+
+		return result;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename InputIt>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::insert_batch(InputIt first, InputIt last) {
+		if (_size == 0) {
+			assign(first, last);
+			return _size;
+		}
+
+		std::size_t size = _size;
+		std::vector<T> values(first, last);
+
+		// In comparator order, consecutive inserts walk down mostly the same path, which the previous ones left in cache
+		// Stable, so the first of several equal values is the one inserted
+		std::stable_sort(values.begin(), values.end(), [this](const T& a, const T& b) -> bool {
+			return compare(a, b) < 0;
+		});
+
+		// Each group is looked up interleaved first, which leaves the rest of its paths in cache and skips the values already there
+		bool found[batch_width];
+
+		for (std::size_t i = 0; i < values.size(); i += batch_width) {
+			std::size_t n = std::min<std::size_t>(batch_width, values.size() - i);
+
+			contains_batch(values.begin() + i, values.begin() + i + n, found);
+
+			for (std::size_t j = 0; j < n; ++j) {
+				if (!found[j]) {
+					insert(std::move(values[i + j]));
+				}
+			}
+		}
+
+		return _size - size;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::parent(const T& data, T& ref) {
+		gAVLNode<T, Augment>* p = find(data);
+
+		if (p == nullptr || p->_parent == nullptr) {
+			return false;
+		}
+
+		ref = p->_parent->_data;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Condition>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search_neighbors(const T& data, std::map<Position,T>& ref, Condition condition) {
+		gAVLAlways gate;
+		return find_neighbors(data, ref, condition, gate);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename Condition, typename C, typename>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search_neighbors(const K& key, std::map<Position,T>& ref, Condition condition) {
+		gAVLAlways gate;
+		return find_neighbors(key, ref, condition, gate);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Condition, typename SubtreeCondition>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search_neighbors(const T& data, std::map<Position,T>& ref, Condition condition, SubtreeCondition subtree_condition) {
+		gAVLSummaryGate<SubtreeCondition> gate(subtree_condition);
+		return find_neighbors(data, ref, condition, gate);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename Condition, typename SubtreeCondition, typename C, typename>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search_neighbors(const K& key, std::map<Position,T>& ref, Condition condition, SubtreeCondition subtree_condition) {
+		gAVLSummaryGate<SubtreeCondition> gate(subtree_condition);
+		return find_neighbors(key, ref, condition, gate);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Condition>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search_before(const T& data, T& ref, Condition condition) {
+		gAVLAlways gate;
+		gAVLNode<T, Augment>* node = find_before(data, condition, gate);
+
+		if (node == nullptr) {
+			return false;
+		}
+
+		ref = node->_data;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename Condition, typename C, typename>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search_before(const K& key, T& ref, Condition condition) {
+		gAVLAlways gate;
+		gAVLNode<T, Augment>* node = find_before(key, condition, gate);
+
+		if (node == nullptr) {
+			return false;
+		}
+
+		ref = node->_data;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Condition, typename SubtreeCondition>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search_before(const T& data, T& ref, Condition condition, SubtreeCondition subtree_condition) {
+		gAVLSummaryGate<SubtreeCondition> gate(subtree_condition);
+		gAVLNode<T, Augment>* node = find_before(data, condition, gate);
+
+		if (node == nullptr) {
+			return false;
+		}
+
+		ref = node->_data;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename Condition, typename SubtreeCondition, typename C, typename>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search_before(const K& key, T& ref, Condition condition, SubtreeCondition subtree_condition) {
+		gAVLSummaryGate<SubtreeCondition> gate(subtree_condition);
+		gAVLNode<T, Augment>* node = find_before(key, condition, gate);
+
+		if (node == nullptr) {
+			return false;
+		}
+
+		ref = node->_data;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Condition>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search_after(const T& data, T& ref, Condition condition) {
+		gAVLAlways gate;
+		gAVLNode<T, Augment>* node = find_after(data, condition, gate);
+
+		if (node == nullptr) {
+			return false;
+		}
+
+		ref = node->_data;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename Condition, typename C, typename>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search_after(const K& key, T& ref, Condition condition) {
+		gAVLAlways gate;
+		gAVLNode<T, Augment>* node = find_after(key, condition, gate);
+
+		if (node == nullptr) {
+			return false;
+		}
+
+		ref = node->_data;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Condition, typename SubtreeCondition>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search_after(const T& data, T& ref, Condition condition, SubtreeCondition subtree_condition) {
+		gAVLSummaryGate<SubtreeCondition> gate(subtree_condition);
+		gAVLNode<T, Augment>* node = find_after(data, condition, gate);
+
+		if (node == nullptr) {
+			return false;
+		}
+
+		ref = node->_data;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename Condition, typename SubtreeCondition, typename C, typename>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search_after(const K& key, T& ref, Condition condition, SubtreeCondition subtree_condition) {
+		gAVLSummaryGate<SubtreeCondition> gate(subtree_condition);
+		gAVLNode<T, Augment>* node = find_after(key, condition, gate);
+
+		if (node == nullptr) {
+			return false;
+		}
+
+		ref = node->_data;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	std::vector<T> gAVL<T, Compare, Allocator, Augment, Stats>::to_stl_vector() {
+		std::vector<T> v;
+		to_stl_vector(v);
+
+		return v;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::to_stl_vector(std::vector<T>& out) {
+		out.clear();
+		out.reserve(_size);
+
+		auto append = [&out](const gAVLNode<T, Augment>* node) {
+			out.push_back(node->_data);
+		};
+
+		walk(static_cast<const gAVLNode<T, Augment>*>(_root), append);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Visitor>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::for_each(Visitor visitor) const {
+		auto visit = [&visitor](const gAVLNode<T, Augment>* node) {
+			visitor(node->_data);
+		};
+
+		walk(static_cast<const gAVLNode<T, Augment>*>(_root), visit);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Visitor>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::for_each_range(const T& lo, const T& hi, Visitor visitor) const {
+		visit_range(lo, hi, visitor);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename Visitor, typename C, typename>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::for_each_range(const K& lo, const K& hi, Visitor visitor) const {
+		visit_range(lo, hi, visitor);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename Visitor>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::visit_range(const K& lo, const K& hi, Visitor& visitor) const {
+		// Stepping to the successor climbs back up at most as often as it went down, so this is amortized O(1) per value
+		const gAVLNode<T, Augment>* p = lower_node(lo);
+
+		while (p != nullptr && compare(hi, p->_data) >= 0) {
+			visitor(p->_data);
+			p = successor(p);
+		}
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename E, typename Visitor>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::overlapping(const E& a, const E& b, Visitor visitor) const {
+		// In-order walk over the parent links that never enters a subtree ending before a, and stops at the first interval starting
+		// after b, since every one after it does too. Each node it passes either overlaps [a, b], is the ancestor of one that does,
+		// or lies on the path of b
+		typedef typename gAVLNode<T, Augment>::interval_type Interval;
+
+		const gAVLNode<T, Augment>* p = _root;
+
+		if (p == nullptr || p->_max_high < a) {
+			return;
+		}
+
+		bool down = true;
+
+		while (true) {
+			if (down && p->_left != nullptr && !(p->_left->_max_high < a)) {
+				p = p->_left;
+				continue;
+			}
+
+			if (b < Interval::low(p->_data)) {
+				return;
+			}
+
+			if (!(Interval::high(p->_data) < a)) {
+				visitor(p->_data);
+			}
+
+			if (p->_right != nullptr && !(p->_right->_max_high < a)) {
+				p = p->_right;
+				down = true;
+				continue;
+			}
+
+			// Subtree of p is done, climb until arriving from a left child, whose parent is next in order
+			while (true) {
+				if (p->_parent == nullptr) {
+					return;
+				}
+
+				bool from_left = (p == p->_parent->_left);
+				p = p->_parent;
+
+				if (from_left) {
+					break;
+				}
+			}
+
+			down = false;
+		}
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename E>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::any_overlap(const E& a, const E& b) const {
+		return find_overlap(a, b) != nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename E>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::any_overlap(const E& a, const E& b, T& ref) const {
+		const gAVLNode<T, Augment>* q = find_overlap(a, b);
+
+		if (q == nullptr) {
+			return false;
+		}
+
+		ref = q->_data;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename E>
+	const gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::find_overlap(const E& a, const E& b) const {
+		// A single descent: if the left subtree reaches a but holds no overlap, the interval reaching a starts after b, and so does
+		// every interval of the right subtree, which can be skipped. Otherwise nothing on the left reaches a, leaving the right
+		typedef typename gAVLNode<T, Augment>::interval_type Interval;
+
+		const gAVLNode<T, Augment>* q = _root;
+
+		while (q != nullptr) {
+			if (!(b < Interval::low(q->_data)) && !(Interval::high(q->_data) < a)) {
+				return q;
+			}
+
+			q = (q->_left != nullptr && !(q->_left->_max_high < a)) ? q->_left : q->_right;
+		}
+
+		return nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::root(T& data) {
+		if (_root != nullptr) {
+			data = _root->_data;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search(const T& search_data, T& found_data) {
+		auto node = find(search_data);
+
+		if (node != nullptr && compare(search_data, node->_data) == 0) {
+			found_data = node->_data;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename C, typename>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::search(const K& search_key, T& found_data) {
+		auto node = find(search_key);
+
+		if (node != nullptr) {
+			found_data = node->_data;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator gAVL<T, Compare, Allocator, Augment, Stats>::begin() const {
+		return const_iterator(leftmost(_root), this);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator gAVL<T, Compare, Allocator, Augment, Stats>::end() const {
+		return const_iterator(nullptr, this);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator gAVL<T, Compare, Allocator, Augment, Stats>::cbegin() const {
+		return begin();
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator gAVL<T, Compare, Allocator, Augment, Stats>::cend() const {
+		return end();
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_reverse_iterator gAVL<T, Compare, Allocator, Augment, Stats>::rbegin() const {
+		return const_reverse_iterator(end());
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_reverse_iterator gAVL<T, Compare, Allocator, Augment, Stats>::rend() const {
+		return const_reverse_iterator(begin());
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_reverse_iterator gAVL<T, Compare, Allocator, Augment, Stats>::crbegin() const {
+		return rbegin();
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_reverse_iterator gAVL<T, Compare, Allocator, Augment, Stats>::crend() const {
+		return rend();
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator gAVL<T, Compare, Allocator, Augment, Stats>::select(std::size_t k) const {
+		const gAVLNode<T, Augment>* q = _root;
+
+		while (q != nullptr) {
+			std::size_t left = count(q->_left);
+
+			if (k < left) {
+				q = q->_left;
+			} else if (k == left) {
+				break;
+			} else {
+				k -= left + 1;
+				q = q->_right;
+			}
+		}
+
+		return const_iterator(q, this);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::rank(const T& data) const {
+		return rank_node(data, false);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::count_range(const T& lo, const T& hi) const {
+		if (compare(lo, hi) > 0) {
+			return 0;
+		}
+
+		return rank_node(hi, true) - rank_node(lo, false);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename C, typename>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::rank(const K& key) const {
+		return rank_node(key, false);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename C, typename>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::count_range(const K& lo, const K& hi) const {
+		std::size_t before_hi = rank_node(hi, true);
+		std::size_t before_lo = rank_node(lo, false);
+
+		// Keys can't be compared with each other directly, an empty (reversed) range shows up as lo ranking past hi
+		return (before_hi > before_lo) ? before_hi - before_lo : 0;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator gAVL<T, Compare, Allocator, Augment, Stats>::lower_bound(const T& data) const {
+		return const_iterator(lower_node(data), this);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator gAVL<T, Compare, Allocator, Augment, Stats>::upper_bound(const T& data) const {
+		return const_iterator(upper_node(data), this);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator gAVL<T, Compare, Allocator, Augment, Stats>::lower_bound(const_iterator finger, const T& data) const {
+		int comp = 0;
+		gAVLNode<T, Augment>* p = finger_slot(finger._node, data, comp);
+
+		return const_iterator((p != nullptr && comp > 0) ? successor(p) : p, this);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator gAVL<T, Compare, Allocator, Augment, Stats>::upper_bound(const_iterator finger, const T& data) const {
+		int comp = 0;
+		gAVLNode<T, Augment>* p = finger_slot(finger._node, data, comp);
+
+		return const_iterator((p != nullptr && comp >= 0) ? successor(p) : p, this);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename C, typename>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator gAVL<T, Compare, Allocator, Augment, Stats>::lower_bound(const K& key) const {
+		return const_iterator(lower_node(key), this);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename C, typename>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator gAVL<T, Compare, Allocator, Augment, Stats>::upper_bound(const K& key) const {
+		return const_iterator(upper_node(key), this);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::allocator_type gAVL<T, Compare, Allocator, Augment, Stats>::get_allocator() const {
+		return allocator_type(_allocator);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLFrozen<T, Compare> gAVL<T, Compare, Allocator, Augment, Stats>::freeze() const {
+		return gAVLFrozen<T, Compare>(begin(), end(), _comparator);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::save(std::ostream& out) const {
+		return freeze().save(out);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::load(std::istream& in) {
+		gAVLFrozen<T, Compare> image(_comparator);
+
+		if (!image.load(in)) {
+			return false;
+		}
+
+		// The frozen copy hands the values out in comparator order, which assign() builds from in O(n)
+		assign(image.begin(), image.end());
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLCounters gAVL<T, Compare, Allocator, Augment, Stats>::stats() const {
+		return _stats.snapshot();
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::reset_stats() {
+		_stats.reset();
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename... Args>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::create_node(Args&&... args) {
+		gAVLNode<T, Augment>* node = node_traits::allocate(_allocator, 1);
+
+		try {
+			node_traits::construct(_allocator, node, std::forward<Args>(args)...);
+		} catch (...) {
+			node_traits::deallocate(_allocator, node, 1);
+			throw;
+		}
+
+		_stats.allocated();
+
+		return node;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::destroy_node(gAVLNode<T, Augment>* node) {
+		node_traits::destroy(_allocator, node);
+		node_traits::deallocate(_allocator, node, 1);
+		_stats.deallocated();
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename A, typename B>
+	int gAVL<T, Compare, Allocator, Augment, Stats>::compare(const A& a, const B& b) const {
+		_stats.compared();
+
+		return _comparator(a, b);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Condition>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::test(Condition& condition, const T& data) const {
+		_stats.visited();
+
+		return condition(data);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::clone(const gAVLNode<T, Augment>* root) {
+		if (root == nullptr) {
+			return nullptr;
+		}
+
+		// Pre-order walk over the parent links of the source, mirroring each node (and its balance factor) as it is reached
+		gAVLNode<T, Augment>* copy = create_node(root->_data);
+		copy->set_balance_factor(root->balance_factor());
+		static_cast<typename Augment::node_data&>(*copy) = *root;
+
+		const gAVLNode<T, Augment>* p = root;
+		gAVLNode<T, Augment>* c = copy;
+
+		while (p != nullptr) {
+			if (p->_left != nullptr && c->_left == nullptr) {
+				c->_left = create_node(p->_left->_data);
+				c->_left->_parent = c;
+				c->_left->set_balance_factor(p->_left->balance_factor());
+				static_cast<typename Augment::node_data&>(*c->_left) = *p->_left;
+				p = p->_left;
+				c = c->_left;
+			} else if (p->_right != nullptr && c->_right == nullptr) {
+				c->_right = create_node(p->_right->_data);
+				c->_right->_parent = c;
+				c->_right->set_balance_factor(p->_right->balance_factor());
+				static_cast<typename Augment::node_data&>(*c->_right) = *p->_right;
+				p = p->_right;
+				c = c->_right;
+			} else if (p == root) {
+				break;
+			} else {
+				p = p->_parent;
+				c = c->_parent;
+			}
+		}
+
+		return copy;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename Condition, typename Gate>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::find_before(const K& data, Condition& condition, Gate& gate) const {
+		int comp = 0;
+		gAVLNode<T, Augment>* q = find_slot(data, comp);
+
+		return before_slot(q, comp, condition, gate);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename Condition, typename Gate>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::find_after(const K& data, Condition& condition, Gate& gate) const {
+		int comp = 0;
+		gAVLNode<T, Augment>* q = find_slot(data, comp);
+
+		return after_slot(q, comp, condition, gate);
+	}
+
+	// Might seem redundant, but saves a constant factor if you plan on looking both before and after
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename Condition, typename Gate>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::find_neighbors(const K& data, std::map<Position,T>& ref, Condition& condition, Gate& gate) const {
+		// Get to spot where data is, or data should be
+		int comp = 0;
+		gAVLNode<T, Augment>* q = find_slot(data, comp);
+
+		if (q == nullptr) {
+			return false;
+		}
 
-		T _data;
+		std::size_t s = ref.size();
 
-		std::shared_ptr<gAVLNode> _parent;
-		std::shared_ptr<gAVLNode> _left;
-		std::shared_ptr<gAVLNode> _right;
-		int _balance_factor;
-	};
+		if (comp == 0) {
+			ref.insert(std::pair<Position, T>(Position::Equal, q->_data));
+		}
 
-	// A self-balancing binary search tree implementing AVL tree -- Space O(n)
-	// https://en.wikipedia.org/wiki/AVL_tree
-	template <typename T>
-	class gAVL {
-		public:
-			gAVL(std::function<int(const T&, const T&)> comparator);
-			~gAVL();
+		gAVLNode<T, Augment>* before = before_slot(q, comp, condition, gate);
 
-			enum class Position : int {
-				Before,
-				After,
-				Equal
-			};
+		if (before != nullptr) {
+			ref.insert(std::pair<Position, T>(Position::Before, before->_data));
+		}
 
-			bool insert(const T& data);				// Adds the data value to the tree (if it already exists in the tree, does nothing) [O(log(n))]
-			bool remove(const T& data);				// Removes the data value from the tree (if it does not exist in the tree does nothing) [O(log(n))]
+		gAVLNode<T, Augment>* after = after_slot(q, comp, condition, gate);
 
-			std::size_t size();						// Returns the number of items stored in the tree [O(1)]
-			int height();							// Returns the height of the tree (if you *must* know) [O(n)]
-			std::tuple<int, int> height_bounds();	// Returns the theoretical upper and lower bounds of the AVL tree [O(1)]
-			bool contains(const T& data);			// Returns true if the data value is contained in the tree, false otherwise [O(log(n))]
-			bool parent(const T& data, T& ref);		// Returns the parent of data within the tree if it exists, otherwise returns false and doesn't alter ref [O(log(n))]
-			bool search_neighbors(const T& data, std::map<Position,T>& ref, std::function<bool(const T&)> condition = [](const T&) -> bool { return true; }); // Return the insertion neighborhood of data (what it would be adjacent to if you did insert it). --> Worst case O(n), typically far better
-			bool search_before(const T& data, T& ref, std::function<bool(const T&)> condition = [](const T&) -> bool { return true; });	// Worst case [O(n)], typically far better
-			bool search_after(const T& data, T& ref, std::function<bool(const T&)> condition = [](const T&) -> bool { return true; }); // Worst case [O(n)], typically far better
+		if (after != nullptr) {
+			ref.insert(std::pair<Position, T>(Position::After, after->_data));
+		}
 
-			std::vector<T> to_stl_vector();			// Returns the tree as an ordered vector, with the comparator "least" (negative to all others) value first, and the comparator "most" (positive to all others) last [O(n)]
-			bool root(T& data);
-			bool search(const T& search_data, T& found_data);
+		return ref.size() > s;
+	}
 
-		protected:
-			std::shared_ptr<gAVLNode<T>> find(const T& data);
-			void retrace_insert(std::shared_ptr<gAVLNode<T>> node);
-			void retrace_remove(std::shared_ptr<gAVLNode<T>> node);
-			std::shared_ptr<gAVLNode<T>> rotate_right(std::shared_ptr<gAVLNode<T>> A, std::shared_ptr<gAVLNode<T>> B);
-			std::shared_ptr<gAVLNode<T>> rotate_left(std::shared_ptr<gAVLNode<T>> A, std::shared_ptr<gAVLNode<T>> B);
-			std::shared_ptr<gAVLNode<T>> rotate_right_left(std::shared_ptr<gAVLNode<T>> A, std::shared_ptr<gAVLNode<T>> B);
-			std::shared_ptr<gAVLNode<T>> rotate_left_right(std::shared_ptr<gAVLNode<T>> A, std::shared_ptr<gAVLNode<T>> B);
-
-			std::function<int(const T&, const T&)> _comparator;
-			std::shared_ptr<gAVLNode<T>> _root;
-			std::size_t _size;
-	};
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Condition, typename Gate>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::before_slot(gAVLNode<T, Augment>* q, int comp, Condition& condition, Gate& gate) const {
+		// q and comp are where find_slot() ended up: everything before the key is either in q's left subtree (q equal to, or before the key),
+		// q itself (before the key), or one of the ancestors approached from its right side along with that ancestor's left subtree.
+		// Walking back up visits those in descending order, so the first match is the answer
+		if (q == nullptr) {
+			return nullptr;
+		}
 
-	template <typename T>
-	gAVL<T>::gAVL(std::function<int(const T&, const T&)> comparator): _comparator(comparator), _root(nullptr), _size(0) {
+		_stats.scanned();
+
+		if (comp >= 0) {
+			if (comp > 0 && test(condition, q->_data)) {
+				return q;
+			}
+
+			gAVLNode<T, Augment>* m = last_match(q->_left, condition, gate);
+
+			if (m != nullptr) {
+				return m;
+			}
+		}
+
+		for (gAVLNode<T, Augment>* X = q->_parent; X != nullptr; q = X, X = X->_parent) {
+			if (q == X->_right) {
+				if (test(condition, X->_data)) {
+					return X;
+				}
+
+				gAVLNode<T, Augment>* m = last_match(X->_left, condition, gate);
+
+				if (m != nullptr) {
+					return m;
+				}
+			}
+		}
+
+		return nullptr;
 	}
 
-	template <typename T>
-	gAVL<T>::~gAVL() {
-		// Break parent link of each node in the tree for automatic deallocation when root ref count hits zero
-		std::stack<std::shared_ptr<gAVLNode<T>>> s;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Condition, typename Gate>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::after_slot(gAVLNode<T, Augment>* q, int comp, Condition& condition, Gate& gate) const {
+		// Mirror of before_slot
+		if (q == nullptr) {
+			return nullptr;
+		}
 
-		if (_root != nullptr) {
-			s.push(_root);
+		_stats.scanned();
+
+		if (comp <= 0) {
+			if (comp < 0 && test(condition, q->_data)) {
+				return q;
+			}
+
+			gAVLNode<T, Augment>* m = first_match(q->_right, condition, gate);
+
+			if (m != nullptr) {
+				return m;
+			}
+		}
+
+		for (gAVLNode<T, Augment>* X = q->_parent; X != nullptr; q = X, X = X->_parent) {
+			if (q == X->_left) {
+				if (test(condition, X->_data)) {
+					return X;
+				}
+
+				gAVLNode<T, Augment>* m = first_match(X->_right, condition, gate);
+
+				if (m != nullptr) {
+					return m;
+				}
+			}
+		}
+
+		return nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Condition, typename Gate>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::last_match(gAVLNode<T, Augment>* root, Condition& condition, Gate& gate) const {
+		// Reverse in-order walk of the subtree over the parent links, never entering a subtree the gate rules out
+		// With an exact gate every subtree entered holds a match, so this is a single descent [O(log(n))], otherwise worst case [O(n)]
+		if (root == nullptr || !gate(root)) {
+			return nullptr;
 		}
 
+		gAVLNode<T, Augment>* p = root;
 		bool down = true;
-		while (!s.empty()) {
-			std::shared_ptr<gAVLNode<T>> p = s.top();
 
-			if (down && p->_left != nullptr) {
-				s.push(p->_left);
+		while (true) {
+			if (down && p->_right != nullptr && gate(p->_right)) {
+				p = p->_right;
+				continue;
+			}
+
+			// test value
+			if (test(condition, p->_data)) {
+				return p;
+			}
+
+			if (p->_left != nullptr && gate(p->_left)) {
+				p = p->_left;
+				down = true;
 				continue;
-			} 
+			}
+
+			// Subtree of p is exhausted, climb until arriving from a right child, whose parent still has to be tested
+			while (true) {
+				if (p == root) {
+					return nullptr;
+				}
+
+				bool from_right = (p == p->_parent->_right);
+				p = p->_parent;
+
+				if (from_right) {
+					break;
+				}
+			}
 
 			down = false;
-			s.pop();
+		}
+	}
 
-			// Break link
-			p->_parent = nullptr;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Condition, typename Gate>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::first_match(gAVLNode<T, Augment>* root, Condition& condition, Gate& gate) const {
+		// Mirror of last_match
+		if (root == nullptr || !gate(root)) {
+			return nullptr;
+		}
 
-			if (p->_right != nullptr) {
-				s.push(p->_right);
+		gAVLNode<T, Augment>* p = root;
+		bool down = true;
+
+		while (true) {
+			if (down && p->_left != nullptr && gate(p->_left)) {
+				p = p->_left;
+				continue;
+			}
+
+			// test value
+			if (test(condition, p->_data)) {
+				return p;
+			}
+
+			if (p->_right != nullptr && gate(p->_right)) {
+				p = p->_right;
 				down = true;
 				continue;
 			}
+
+			while (true) {
+				if (p == root) {
+					return nullptr;
+				}
+
+				bool from_left = (p == p->_parent->_left);
+				p = p->_parent;
+
+				if (from_left) {
+					break;
+				}
+			}
+
+			down = false;
 		}
 	}
 
-	template <typename T>
-	bool gAVL<T>::insert(const T& data) {
-		std::shared_ptr<gAVLNode<T>> node = std::make_shared<gAVLNode<T>>();
-		node->_data = data;
-		node->_balance_factor = 0;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K, typename... Args>
+	std::pair<gAVLNode<T, Augment>*, bool> gAVL<T, Compare, Allocator, Augment, Stats>::insert_unique(const K& key, Args&&... args) {
+		int comp = 0;
+		gAVLNode<T, Augment>* p = find_slot(key, comp);
 
-		if (_root == nullptr) {
-			_root = node;
-			_size++;
-			return true;
+		if (p != nullptr && comp == 0) {
+			return std::pair<gAVLNode<T, Augment>*, bool>(p, false);
 		}
 
-		std::shared_ptr<gAVLNode<T>> p = _root;
+		gAVLNode<T, Augment>* node = create_node(std::forward<Args>(args)...);
+		link_node(p, comp, node);
 
-		while (true) {
-			int comp = _comparator(node->_data, p->_data);
+		return std::pair<gAVLNode<T, Augment>*, bool>(node, true);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::find_slot(const K& key, int& comp) const {
+		return find_slot(_root, key, comp);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::find_slot(gAVLNode<T, Augment>* p, const K& key, int& comp) const {
+		// Returns the node equal to key (comp == 0), or the node key would hang off of (left if comp < 0, right if comp > 0)
+		while (p != nullptr) {
+			comp = compare(key, p->_data);
 
 			if (comp < 0) {
-				if (p->_left != nullptr) {
-					p = p->_left;
-				} else {
-					p->_left = node;
-					node->_parent = p;
+				if (p->_left == nullptr) {
 					break;
 				}
+
+				p = p->_left;
 			} else if (comp == 0) {
-				return false;
+				break;
 			} else {
-				if (p->_right != nullptr) {
-					p = p->_right;
-				} else {
-					p->_right = node;
-					node->_parent = p;
+				if (p->_right == nullptr) {
+					break;
+				}
+
+				p = p->_right;
+			}
+		}
+
+		return p;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::finger_slot(const gAVLNode<T, Augment>* finger, const K& key, int& comp) const {
+		if (_root == nullptr) {
+			return nullptr;
+		}
+
+		// finger is a position in this tree, handed out as a const_iterator
+		gAVLNode<T, Augment>* v = (finger != nullptr) ? const_cast<gAVLNode<T, Augment>*>(finger) : rightmost(_root);
+
+		comp = compare(key, v->_data);
+
+		if (comp == 0) {
+			return v;
+		}
+
+		// The slot of key is in the subtree of the lowest node on the way up whose range reaches past key
+		// Ancestors on the far side of key don't change that range (and are passed without a comparison), the first one on its
+		// side bounds it: if key lies before that bound the slot is under start, otherwise the bound takes over as start
+		gAVLNode<T, Augment>* start = v;
+
+		while (v->_parent != nullptr) {
+			gAVLNode<T, Augment>* u = v->_parent;
+
+			if ((comp > 0) == (u->_left == v)) {
+				int c = compare(key, u->_data);
+
+				if (c == 0) {
+					comp = 0;
+					return u;
+				}
+
+				if ((comp > 0) ? (c < 0) : (c > 0)) {
 					break;
 				}
+
+				start = u;
 			}
+
+			v = u;
+		}
+
+		return find_slot(start, key, comp);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename V>
+	std::pair<typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator, bool> gAVL<T, Compare, Allocator, Augment, Stats>::insert_hinted(const gAVLNode<T, Augment>* hint, V&& data) {
+		int comp = 0;
+		gAVLNode<T, Augment>* p = finger_slot(hint, data, comp);
+
+		if (p != nullptr && comp == 0) {
+			return std::pair<const_iterator, bool>(const_iterator(p, this), false);
+		}
+
+		gAVLNode<T, Augment>* node = create_node(std::forward<V>(data));
+		link_node(p, comp, node);
+
+		return std::pair<const_iterator, bool>(const_iterator(node, this), true);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	typename gAVL<T, Compare, Allocator, Augment, Stats>::const_iterator gAVL<T, Compare, Allocator, Augment, Stats>::position(const gAVLNode<T, Augment>* node) const {
+		return const_iterator(node, this);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	const gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::position_node(const_iterator it) {
+		return it._node;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::link_node(gAVLNode<T, Augment>* p, int comp, gAVLNode<T, Augment>* node) {
+		node->_parent = p;
+
+		if (p == nullptr) {
+			_root = node;
+		} else if (comp < 0) {
+			link_traits::relinking(p);
+			p->_left = node;
+		} else {
+			link_traits::relinking(p);
+			p->_right = node;
+		}
+
+		// Bring the summaries along the new path up to date first, the rotations of the retrace then only have to fix the nodes they move
+		if (Augment::enabled) {
+			update_path(node);
 		}
 
-		retrace_insert(node);
+		if (retrace_insert(node)) {
+			_height++;
+		}
 
 		_size++;
+	}
 
-		return true;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::erase_node(gAVLNode<T, Augment>* q) {
+		if (unlink_node(q)) {
+			_height--;
+		}
+
+		destroy_node(q);
+
+		_size--;
 	}
 
-	template <typename T>
-	bool gAVL<T>::remove(const T& data) {
-		if (_root == nullptr) {
-			return false;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::unlink_node(gAVLNode<T, Augment>* q) {
+		link_traits::relinking(q);
+
+		if (q->_left != nullptr && q->_right != nullptr) {
+			// Node to be removed has two children
+			// Trade places with the minimum node of the successor subtree, so the values themselves never have to be copied
+			gAVLNode<T, Augment>* min = q->_right;
+
+			while (min->_left != nullptr) {
+				min = min->_left;
+			}
+
+			swap_with_successor(q, min);
 		}
 
-		std::stack<std::pair<std::shared_ptr<gAVLNode<T>>, T>> s;
+		bool shrunk = retrace_remove(q);
 
-		T rdata = data;
+		gAVLNode<T, Augment>* rep = (q->_right == nullptr) ? q->_left : q->_right;
 
-		while (true) {
-			std::shared_ptr<gAVLNode<T>> q = find(rdata);
+		// Remove and potentially replace
+		if (q->_parent != nullptr) {
+			link_traits::relinking(q->_parent);
 
-			if (q == nullptr) {
-				return false;
+			if (q == q->_parent->_left) {
+				q->_parent->_left = rep;
+			} else {
+				q->_parent->_right = rep;
 			}
+		} else {
+			// This node is the root!
+			_root = rep;
+		}
 
-			std::shared_ptr<gAVLNode<T>> rep = nullptr;
+		if (rep != nullptr) {
+			rep->_parent = q->_parent;
+		}
 
-			if (q->_right == nullptr || q->_left == nullptr) {
-				retrace_remove(q);
+		if (Augment::enabled) {
+			update_path(q->_parent);
+		}
 
-				if (q->_right == nullptr) {
-					rep = q->_left;
-				} else {
-					rep = q->_right;
-				}
+		q->_parent = q->_left = q->_right = nullptr;
+		q->set_balance_factor(0);
 
-				// Remove and potentially replace
-				if (q->_parent != nullptr) {
-					if (_comparator(q->_data, q->_parent->_data) < 0) {
-						q->_parent->_left = rep;
-					} else {
-						q->_parent->_right = rep;
-					}
-				} else {
-					// This node is the root!
-					_root = rep;
-				}
+		return shrunk;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::adopt(gAVL& other) {
+		// Nodes can only change hands between trees whose allocators can free each other's nodes, otherwise they are copied over
+		gAVLNode<T, Augment>* root = other._root;
+
+		if (_allocator == other._allocator) {
+			other._root = nullptr;
+			other._size = 0;
+			other._height = 0;
+		} else {
+			root = clone(other._root);
+			other.clear();
+		}
+
+		return root;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	int gAVL<T, Compare, Allocator, Augment, Stats>::child_height(const gAVLNode<T, Augment>* node, int height, bool left) {
+		// The lower child of node (of the given height) is 2 below it, the other one (or both, when node is balanced) 1 below it
+		if (left) {
+			return height - ((node->balance_factor() > 0) ? 2 : 1);
+		}
+
+		return height - ((node->balance_factor() < 0) ? 2 : 1);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::subtree_size(const gAVLNode<T, Augment>* node) const {
+		return subtree_size(node, std::integral_constant<bool, std::is_base_of<gAVLCountAugment::node_data, typename Augment::node_data>::value>());
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::subtree_size(const gAVLNode<T, Augment>* node, std::true_type) const {
+		return count(node);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::subtree_size(const gAVLNode<T, Augment>* node, std::false_type) const {
+		// No counts to go by, walk the subtree
+		std::size_t n = 0;
+		auto tally = [&n](const gAVLNode<T, Augment>*) { n++; };
+
+		walk(node, tally);
+
+		return n;
+	}
+
+	/*
+		Join based bulk operations, after "Just Join for Parallel Ordered Sets" (Blelloch, Ferizovic, Sun)
+		The subtrees handled here are detached (their roots' parent links are ignored), and _root serves as the root of whichever
+		subtree is being retraced, so callers have to put the real root back in place when they are done
+	*/
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::join(gAVLNode<T, Augment>* L, int hL, gAVLNode<T, Augment>* k, gAVLNode<T, Augment>* R, int hR, int& h) {
+		// Every value of L comes before k, every value of R after it
+		if (L != nullptr) {
+			L->_parent = nullptr;
+		}
+
+		if (R != nullptr) {
+			R->_parent = nullptr;
+		}
+
+		if (hL > hR + 1) {
+			// Follow the right spine of L down to the first subtree c no more than 1 higher than R, and replace it with (c, k, R):
+			// that subtree just grew by one, exactly as if k had been inserted there, so the insertion retrace takes it from there
+			gAVLNode<T, Augment>* p = nullptr;
+			gAVLNode<T, Augment>* c = L;
+			int hc = hL;
+
+			while (hc > hR + 1) {
+				hc = child_height(c, hc, false);
+				p = c;
+				c = c->_right;
+			}
+
+			k->_left = c;
+			k->_right = R;
+			k->_parent = p;
+			k->set_balance_factor(hR - hc);
+			p->_right = k;
+
+			if (c != nullptr) {
+				c->_parent = k;
+			}
+
+			if (R != nullptr) {
+				R->_parent = k;
+			}
+
+			_root = L;
+
+			if (Augment::enabled) {
+				update_path(k);
+			}
+
+			h = hL + (retrace_insert(k) ? 1 : 0);
+		} else if (hR > hL + 1) {
+			// Mirror of the above, down the left spine of R
+			gAVLNode<T, Augment>* p = nullptr;
+			gAVLNode<T, Augment>* c = R;
+			int hc = hR;
+
+			while (hc > hL + 1) {
+				hc = child_height(c, hc, true);
+				p = c;
+				c = c->_left;
+			}
+
+			k->_left = L;
+			k->_right = c;
+			k->_parent = p;
+			k->set_balance_factor(hc - hL);
+			p->_left = k;
+
+			if (c != nullptr) {
+				c->_parent = k;
+			}
+
+			if (L != nullptr) {
+				L->_parent = k;
+			}
+
+			_root = R;
+
+			if (Augment::enabled) {
+				update_path(k);
+			}
+
+			h = hR + (retrace_insert(k) ? 1 : 0);
+		} else {
+			// Close enough in height, k simply becomes the root
+			k->_left = L;
+			k->_right = R;
+			k->_parent = nullptr;
+			k->set_balance_factor(hR - hL);
+
+			if (L != nullptr) {
+				L->_parent = k;
+			}
+
+			if (R != nullptr) {
+				R->_parent = k;
+			}
+
+			Augment::update(k);
+
+			_root = k;
+			h = std::max(hL, hR) + 1;
+		}
+
+		return _root;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::join(gAVLNode<T, Augment>* L, int hL, gAVLNode<T, Augment>* R, int hR, int& h) {
+		// Join without a middle value, the last value of L is taken out to serve as one
+		if (L == nullptr || R == nullptr) {
+			gAVLNode<T, Augment>* root = (L != nullptr) ? L : R;
+
+			if (root != nullptr) {
+				root->_parent = nullptr;
+			}
+
+			h = (L != nullptr) ? hL : hR;
+
+			return root;
+		}
+
+		L->_parent = nullptr;
+		_root = L;
+
+		gAVLNode<T, Augment>* k = rightmost(L);
+
+		if (unlink_node(k)) {
+			hL--;
+		}
+
+		return join(_root, hL, k, R, hR, h);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::split(gAVLNode<T, Augment>* root, int h, const K& key, gAVLNode<T, Augment>*& L, int& hL, gAVLNode<T, Augment>*& R, int& hR) {
+		// Splits the subtree root (of height h) into L, holding the values before key, and R, holding the values after it
+		// The node equal to key (if there is one) ends up in neither, and is returned detached
+		struct Step {
+			gAVLNode<T, Augment>* _node;
+			int _height;
+			bool _left;
+		};
+
+		std::vector<Step> path;
+		gAVLNode<T, Augment>* found = nullptr;
+		gAVLNode<T, Augment>* q = root;
 
-				if (rep != nullptr) {
-					rep->_parent = q->_parent;	
-				}
+		L = R = nullptr;
+		hL = hR = 0;
 
-				// purge, in zero ref fashion (don't risk cycles)
-				q->_parent = q->_left = q->_right = nullptr;
-				
+		while (q != nullptr) {
+			int comp = compare(key, q->_data);
+
+			if (comp == 0) {
+				found = q;
+				L = q->_left;
+				R = q->_right;
+				hL = child_height(q, h, true);
+				hR = child_height(q, h, false);
+
+				found->_parent = found->_left = found->_right = nullptr;
+				found->set_balance_factor(0);
+				Augment::update(found);
 				break;
+			}
 
-			} else {
-				// Node to be removed has two children
-				// Find minimum node in successor subtree
-				std::shared_ptr<gAVLNode<T>> min = q->_right;
+			Step step = { q, h, comp < 0 };
+			path.push_back(step);
 
-				while (min->_left != nullptr) {
-					min = min->_left;
-				}
+			h = child_height(q, h, comp < 0);
+			q = (comp < 0) ? q->_left : q->_right;
+		}
+
+		// Back up the search path, every node on it is joined with its other subtree onto the side of the key it is on
+		while (!path.empty()) {
+			Step step = path.back();
+			path.pop_back();
+
+			gAVLNode<T, Augment>* m = step._node;
 
-				// Replace data later
-				rdata = min->_data;
-				s.push(std::pair<std::shared_ptr<gAVLNode<T>>, T>(q, rdata));
+			if (step._left) {
+				R = join(R, hR, m, m->_right, child_height(m, step._height, false), hR);
+			} else {
+				L = join(m->_left, child_height(m, step._height, true), m, L, hL, hL);
 			}
 		}
 
-		while (!s.empty()) {
-			std::shared_ptr<gAVLNode<T>> q = s.top().first;
-			q->_data = s.top().second;
-			s.pop();
+		// Whichever side never got joined onto may still be linked to its old parent
+		if (L != nullptr) {
+			L->_parent = nullptr;
 		}
 
-		_size--;
+		if (R != nullptr) {
+			R->_parent = nullptr;
+		}
 
-		return true;
+		return found;
 	}
 
-	template <typename T> 
-	std::size_t gAVL<T>::size() {
-		return _size;
-	}
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::unite(gAVLNode<T, Augment>* a, int ha, gAVLNode<T, Augment>* b, int hb, int& h) {
+		// Split a around the root of b, unite the halves with the subtrees of b, then join the results back around that root
+		if (a == nullptr || b == nullptr) {
+			return join(a, ha, b, hb, h);
+		}
 
-	template <typename T>
-	int gAVL<T>::height() {
-		if (_root == nullptr) {
-			return 0;
+		gAVLNode<T, Augment>* bl = b->_left;
+		gAVLNode<T, Augment>* br = b->_right;
+		int hbl = child_height(b, hb, true);
+		int hbr = child_height(b, hb, false);
+
+		gAVLNode<T, Augment>* al = nullptr;
+		gAVLNode<T, Augment>* ar = nullptr;
+		int hal = 0;
+		int har = 0;
+		gAVLNode<T, Augment>* found = split(a, ha, b->_data, al, hal, ar, har);
+
+		int hl = 0;
+		int hr = 0;
+		gAVLNode<T, Augment>* l = unite(al, hal, bl, hbl, hl);
+		gAVLNode<T, Augment>* r = unite(ar, har, br, hbr, hr);
+
+		if (found != nullptr) {
+			// The tree keeps its own value
+			destroy_node(b);
+			_size--;
+			b = found;
 		}
 
-		std::stack<std::pair<std::shared_ptr<gAVLNode<T>>, int>> s;
-		s.push(std::pair<std::shared_ptr<gAVLNode<T>>, int>(_root, 1));
+		return join(l, hl, b, r, hr, h);
+	}
 
-		int max_height = 1;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::intersect(gAVLNode<T, Augment>* a, int ha, gAVLNode<T, Augment>* b, int hb, int& h) {
+		if (a == nullptr || b == nullptr) {
+			_size -= destroy_subtree(a) + destroy_subtree(b);
+			h = 0;
 
-		bool down = true;
-		while (!s.empty()) {
-			std::shared_ptr<gAVLNode<T>> p = s.top().first;
-			int height = s.top().second;
+			return nullptr;
+		}
 
-			if (down && p->_left != nullptr) {
-				s.push(std::pair<std::shared_ptr<gAVLNode<T>>, int>(p->_left, height + 1));
-				continue;
-			}
+		gAVLNode<T, Augment>* bl = b->_left;
+		gAVLNode<T, Augment>* br = b->_right;
+		int hbl = child_height(b, hb, true);
+		int hbr = child_height(b, hb, false);
 
-			down = false;
-			s.pop();
+		gAVLNode<T, Augment>* al = nullptr;
+		gAVLNode<T, Augment>* ar = nullptr;
+		int hal = 0;
+		int har = 0;
+		gAVLNode<T, Augment>* found = split(a, ha, b->_data, al, hal, ar, har);
 
-			// Break link
-			if (height > max_height) {
-				max_height = height;
-			}
+		b->_left = b->_right = nullptr;
 
-			if (p->_right != nullptr) {
-				s.push(std::pair<std::shared_ptr<gAVLNode<T>>, int>(p->_right, height + 1));
-				down = true;
-				continue;
-			}
+		int hl = 0;
+		int hr = 0;
+		gAVLNode<T, Augment>* l = intersect(al, hal, bl, hbl, hl);
+		gAVLNode<T, Augment>* r = intersect(ar, har, br, hbr, hr);
+
+		destroy_node(b);
+		_size--;
+
+		if (found != nullptr) {
+			return join(l, hl, found, r, hr, h);
 		}
 
-		return max_height;
+		return join(l, hl, r, hr, h);
 	}
 
-	template <typename T>
-	std::tuple<int, int> gAVL<T>::height_bounds() {
-		// Theoretical AVL tree height bounds, [lower, upper]
-		static const double phi = (1.0 + std::sqrt(5.0)) / 2.0;
-		static const double c   = 1.0 / std::log2(phi);
-		static const double b   = (c / 2.0) * std::log2(5) - 2.0;
-
-		double n = static_cast<double>(size());
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::subtract(gAVLNode<T, Augment>* a, int ha, gAVLNode<T, Augment>* b, int hb, int& h) {
+		if (a == nullptr || b == nullptr) {
+			_size -= destroy_subtree(b);
+			h = ha;
 
-		return std::tuple<int, int>(
-			static_cast<int>(std::floor(std::log2(n + 1.0))),
-			static_cast<int>(std::ceil(c * std::log2(n + 2.0) + b)) - 1
-		);
-	}
+			if (a != nullptr) {
+				a->_parent = nullptr;
+			}
 
-	template <typename T>
-	bool gAVL<T>::contains(const T& data) {
-		if (find(data) != nullptr) {
-			return true;
+			return a;
 		}
 
-		return false;
-	}
+		gAVLNode<T, Augment>* bl = b->_left;
+		gAVLNode<T, Augment>* br = b->_right;
+		int hbl = child_height(b, hb, true);
+		int hbr = child_height(b, hb, false);
 
-	template <typename T>
-	bool gAVL<T>::parent(const T& data, T& ref) {
-		std::shared_ptr<gAVLNode<T>> p = find(data);
+		gAVLNode<T, Augment>* al = nullptr;
+		gAVLNode<T, Augment>* ar = nullptr;
+		int hal = 0;
+		int har = 0;
+		gAVLNode<T, Augment>* found = split(a, ha, b->_data, al, hal, ar, har);
 
-		if (p == nullptr || p->_parent == nullptr) {
-			return false;
+		b->_left = b->_right = nullptr;
+
+		int hl = 0;
+		int hr = 0;
+		gAVLNode<T, Augment>* l = subtract(al, hal, bl, hbl, hl);
+		gAVLNode<T, Augment>* r = subtract(ar, har, br, hbr, hr);
+
+		destroy_node(b);
+		_size--;
+
+		if (found != nullptr) {
+			destroy_node(found);
+			_size--;
 		}
 
-		ref = p->_parent->_data;
+		return join(l, hl, r, hr, h);
+	}
 
-		return true;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::set_operation(SetOperation op, gAVLNode<T, Augment>* a, int ha, gAVLNode<T, Augment>* b, int hb, int& h) {
+		switch (op) {
+			case Unite:
+				return unite(a, ha, b, hb, h);
+			case Intersect:
+				return intersect(a, ha, b, hb, h);
+			default:
+				return subtract(a, ha, b, hb, h);
+		}
 	}
 
-	// Might seem redundant, but saves a constant factor if you plan on looking both before and after
-	template <typename T>
-	bool gAVL<T>::search_neighbors(const T& data, std::map<Position,T>& ref, std::function<bool(const T&)> condition) {
-		if (_root == nullptr) {
-			return false;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Pool>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::set_operation(SetOperation op, gAVLNode<T, Augment>* a, int ha, gAVLNode<T, Augment>* b, int hb, int& h, Pool& pool) {
+		// Same recursion as unite/intersect/subtract, with both halves run as separate tasks while b is large enough to be worth it
+		if (a == nullptr || b == nullptr || hb <= parallel_grain) {
+			return set_operation(op, a, ha, b, hb, h);
 		}
 
-		int s = static_cast<int>(ref.size());
+		gAVLNode<T, Augment>* bl = b->_left;
+		gAVLNode<T, Augment>* br = b->_right;
+		int hbl = child_height(b, hb, true);
+		int hbr = child_height(b, hb, false);
+
+		gAVLNode<T, Augment>* al = nullptr;
+		gAVLNode<T, Augment>* ar = nullptr;
+		int hal = 0;
+		int har = 0;
+		gAVLNode<T, Augment>* found = split(a, ha, b->_data, al, hal, ar, har);
+
+		b->_left = b->_right = nullptr;
+
+		// Each task gets a tree of its own to use as scratch (_root) and to count the values it drops in (_size)
+		gAVL left(_comparator, get_allocator());
+		gAVL right(_comparator, get_allocator());
+		gAVLNode<T, Augment>* l = nullptr;
+		gAVLNode<T, Augment>* r = nullptr;
+		int hl = 0;
+		int hr = 0;
+
+		pool.fork_join([&]() { l = left.set_operation(op, al, hal, bl, hbl, hl, pool); }, [&]() { r = right.set_operation(op, ar, har, br, hbr, hr, pool); });
+
+		// Those sizes only ever went down from 0, unsigned wrap-around makes the sum come out right
+		_size += left._size + right._size;
+		_stats.absorb(left._stats);
+		_stats.absorb(right._stats);
+		left._root = right._root = nullptr;
+		left._size = right._size = 0;
+
+		switch (op) {
+			case Unite:
+				if (found != nullptr) {
+					destroy_node(b);
+					_size--;
+					b = found;
+				}
 
-		// Get to spot where data is, or data should be
-		std::shared_ptr<gAVLNode<T>> q = _root;
-		std::stack<std::shared_ptr<gAVLNode<T>>> search_stack;
+				return join(l, hl, b, r, hr, h);
+			case Intersect:
+				destroy_node(b);
+				_size--;
 
-		while (q != nullptr) {
-			int comp = _comparator(data, q->_data);
+				if (found != nullptr) {
+					return join(l, hl, found, r, hr, h);
+				}
 
-			search_stack.push(q);
+				return join(l, hl, r, hr, h);
+			default:
+				destroy_node(b);
+				_size--;
 
-			if (comp < 0) {
-				q = q->_left;
-			} else if (comp == 0) {
-				break;
-			} else {
-				q = q->_right;
-			}
+				if (found != nullptr) {
+					destroy_node(found);
+					_size--;
+				}
+
+				return join(l, hl, r, hr, h);
 		}
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Pool>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::set_operation(SetOperation op, gAVL& other, Pool& pool) {
+		std::size_t m = other._size;
+		int hb = other._height;
+		gAVLNode<T, Augment>* b = adopt(other);
 
-		if (search_stack.size() > 0) {
-			q = search_stack.top();
+		_size += m;
+
+		if (gAVLConcurrentAllocator<Allocator>::value) {
+			_root = set_operation(op, _root, _height, b, hb, _height, pool);
 		} else {
-			return false;
+			_root = set_operation(op, _root, _height, b, hb, _height);
 		}
+	}
 
-		bool eq_comp = (_comparator(data, q->_data) == 0);
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	const std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::batch_width;
 
-		if (eq_comp) {
-			ref.insert(std::pair<Position, T>(Position::Equal, q->_data));
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::prefetch(const gAVLNode<T, Augment>* node) {
+#if defined(__GNUC__) || defined(__clang__)
+		if (node != nullptr) {
+			__builtin_prefetch(node);
 		}
+#else
+		(void)node;
+#endif
+	}
 
-		// look before
-		{
-			std::stack<std::shared_ptr<gAVLNode<T>>> s = search_stack;
-			bool down = true;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Node, typename F>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::walk(Node* root, F& f) {
+		// In-order walk over the parent links that never leaves the subtree of root, so it works on any subtree in place
+		if (root == nullptr) {
+			return;
+		}
 
-			if (eq_comp) {
-				if (q->_left != nullptr) {
-					s.push(q->_left);
-				} else if (q->_parent != nullptr) {
-					s.pop();
-					down = false;
-				} else {
-					return false;
-				}
-			}
+		Node* p = leftmost(root);
 
-			while (!s.empty()) {
-				std::shared_ptr<gAVLNode<T>> p = s.top();
+		while (p != nullptr) {
+			f(p);
 
-				if (down && p->_right != nullptr) {
-					s.push(p->_right);
-					continue;
-				}
+			if (p->_right != nullptr) {
+				p = leftmost(static_cast<Node*>(p->_right));
+				continue;
+			}
 
-				down = false;
-				s.pop();
+			while (p != root && p == p->_parent->_right) {
+				p = p->_parent;
+			}
 
-				// test value
-				if (_comparator(p->_data, data) < 0 && condition(p->_data)) {
-					ref.insert(std::pair<Position, T>(Position::Before, p->_data));
-					break;
-				}
+			p = (p == root) ? nullptr : static_cast<Node*>(p->_parent);
+		}
+	}
 
-				if (p->_left != nullptr) {
-					s.push(p->_left);
-					down = true;
-				}
-			}
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::pieces(gAVLNode<T, Augment>* node, int h, std::vector<std::pair<gAVLNode<T, Augment>*, bool>>& out) {
+		// Cuts the subtree of node (of height h) into, in order, whole subtrees no higher than parallel_grain (true) and the single nodes above them (false)
+		if (node == nullptr) {
+			return;
 		}
 
-		// Look after
-		{
-			std::stack<std::shared_ptr<gAVLNode<T>>> s = search_stack;
-			bool down = true;
+		if (h <= parallel_grain) {
+			out.push_back(std::make_pair(node, true));
+			return;
+		}
 
-			if (eq_comp) {
-				if (q->_right != nullptr) {
-					s.push(q->_right);
-				} else if (q->_parent != nullptr) {
-					s.pop();
-					down = false;
-				} else {
-					return false;
-				}
-			}
+		pieces(node->_left, child_height(node, h, true), out);
+		out.push_back(std::make_pair(node, false));
+		pieces(node->_right, child_height(node, h, false), out);
+	}
 
-			while (!s.empty()) {
-				std::shared_ptr<gAVLNode<T>> p = s.top();
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Pool, typename F>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::parallel_for(Pool& pool, std::size_t begin, std::size_t end, F& f) {
+		// Calls f(i) for every i in [begin, end), halving the range into tasks down to a single index
+		if (end - begin <= 1) {
+			if (begin < end) {
+				f(begin);
+			}
 
-				if (down && p->_left != nullptr) {
-					s.push(p->_left);
-					continue;
-				}
+			return;
+		}
 
-				down = false;
-				s.pop();
+		std::size_t mid = begin + (end - begin) / 2;
 
-				// test value
-				if (_comparator(p->_data, data) > 0 && condition(p->_data)) {
-					ref.insert(std::pair<Position, T>(Position::After, p->_data));
-					return true;
-				}
+		pool.fork_join([&]() { parallel_for(pool, begin, mid, f); }, [&]() { parallel_for(pool, mid, end, f); });
+	}
 
-				if (p->_right != nullptr) {
-					s.push(p->_right);
-					down = true;
-				}
-			}
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Pool>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::build(gAVLNode<T, Augment>* const* nodes, std::size_t n, gAVLNode<T, Augment>* parent, Pool& pool) {
+		// Same as build() above, the two halves being independent
+		if (n < (static_cast<std::size_t>(1) << parallel_grain)) {
+			return build(nodes, n, parent);
 		}
 
-		return (ref.size() - s) > 0;
+		std::size_t mid = n / 2;
+		gAVLNode<T, Augment>* node = nodes[mid];
+
+		node->_parent = parent;
+		pool.fork_join([&]() { node->_left = build(nodes, mid, node, pool); }, [&]() { node->_right = build(nodes + mid + 1, n - mid - 1, node, pool); });
+		node->set_balance_factor(build_height(n - mid - 1) - build_height(mid));
+
+		Augment::update(node);
+
+		return node;
 	}
 
-	template <typename T>
-	bool gAVL<T>::search_before(const T& data, T& ref, std::function<bool(const T&)> condition) {
-		if (_root == nullptr) {
-			return false;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::build(gAVLNode<T, Augment>* const* nodes, std::size_t n, gAVLNode<T, Augment>* parent) {
+		// nodes is in comparator order: the middle one becomes the root, each half a subtree
+		// The left half gets the extra node when n is even, so it is never shorter than the right, and their heights differ by at most one
+		if (n == 0) {
+			return nullptr;
 		}
 
-		// Get to spot where data is, or data should be
-		std::shared_ptr<gAVLNode<T>> q = _root;
-		std::stack<std::shared_ptr<gAVLNode<T>>> s;
+		std::size_t mid = n / 2;
+		gAVLNode<T, Augment>* node = nodes[mid];
 
-		while (q != nullptr) {
-			int comp = _comparator(data, q->_data);
+		node->_parent = parent;
+		node->_left = build(nodes, mid, node);
+		node->_right = build(nodes + mid + 1, n - mid - 1, node);
+		node->set_balance_factor(build_height(n - mid - 1) - build_height(mid));
 
-			s.push(q);
+		Augment::update(node);
 
-			if (comp < 0) {
-				q = q->_left;
-			} else if (comp == 0) {
-				break;
-			} else {
-				q = q->_right;
-			}
-		}
+		return node;
+	}
 
-		if (s.size() > 0) {
-			q = s.top();
-		} else {
-			return false;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	int gAVL<T, Compare, Allocator, Augment, Stats>::build_height(std::size_t n) {
+		// Height of the tree build() makes out of n nodes, ceil(log2(n + 1))
+		int h = 0;
+
+		for (; n > 0; n >>= 1) {
+			h++;
 		}
 
-		// look before
-		bool down = true;
+		return h;
+	}
 
-		if (_comparator(data, q->_data) == 0) {
-			if (q->_left != nullptr) {
-				s.push(q->_left);
-			} else if (q->_parent != nullptr) {
-				s.pop();
-				down = false;
-			} else {
-				return false;
-			}
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::swap_with_successor(gAVLNode<T, Augment>* q, gAVLNode<T, Augment>* s) {
+		// s is the leftmost node of q's right subtree, so it has no left child
+		gAVLNode<T, Augment>* qp = q->_parent;
+		gAVLNode<T, Augment>* ql = q->_left;
+		gAVLNode<T, Augment>* qr = q->_right;
+		gAVLNode<T, Augment>* sp = s->_parent;
+		gAVLNode<T, Augment>* sr = s->_right;
+
+		int balance_factor = q->balance_factor();
+		q->set_balance_factor(s->balance_factor());
+		s->set_balance_factor(balance_factor);
+
+		if (qp != nullptr) {
+			link_traits::relinking(qp);
 		}
 
-		while (!s.empty()) {
-			std::shared_ptr<gAVLNode<T>> p = s.top();
+		link_traits::relinking(q);
+		link_traits::relinking(s);
+		link_traits::relinking(sp);
 
-			if (down && p->_right != nullptr) {
-				s.push(p->_right);
-				continue;
-			}
+		// s takes the place of q...
+		s->_parent = qp;
 
-			down = false;
-			s.pop();
+		if (qp == nullptr) {
+			_root = s;
+		} else if (qp->_left == q) {
+			qp->_left = s;
+		} else {
+			qp->_right = s;
+		}
 
-			// test value
-			if (_comparator(p->_data, data) < 0 && condition(p->_data)) {
-				ref = p->_data;
-				return true;
-			}
+		s->_left = ql;
+		ql->_parent = s;
 
-			if (p->_left != nullptr) {
-				s.push(p->_left);
-				down = true;
-			}
+		if (qr == s) {
+			s->_right = q;
+			q->_parent = s;
+		} else {
+			s->_right = qr;
+			qr->_parent = s;
+			sp->_left = q;
+			q->_parent = sp;
 		}
 
-		return false;
-	}
+		// ...and q the place of s
+		q->_left = nullptr;
+		q->_right = sr;
 
-	template <typename T>
-	bool gAVL<T>::search_after(const T& data, T& ref, std::function<bool(const T&)> condition) {
-		if (_root == nullptr) {
-			return false;
+		if (sr != nullptr) {
+			sr->_parent = q;
 		}
+	}
 
-		// Get to spot where data is, or data should be
-		std::shared_ptr<gAVLNode<T>> q = _root;
-		std::stack<std::shared_ptr<gAVLNode<T>>> s;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::find(const K& data) {
+		gAVLNode<T, Augment>* q = _root;
 
 		while (q != nullptr) {
-			int comp = _comparator(data, q->_data);
-
-			s.push(q);
+			int comp = compare(data, q->_data);
 
 			if (comp < 0) {
 				q = q->_left;
@@ -519,177 +3664,194 @@ namespace bst {
 			}
 		}
 
-		if (s.size() > 0) {
-			q = s.top();
-		} else {
-			return false;
-		}
+		return q;
+	}
 
-		// look after
-		bool down = true;
 
-		if (_comparator(data, q->_data) == 0) {
-			if (q->_right != nullptr) {
-				s.push(q->_right);
-			} else if (q->_parent != nullptr) {
-				s.pop();
-				down = false;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::lower_node(const K& key) const {
+		gAVLNode<T, Augment>* q = _root;
+		gAVLNode<T, Augment>* bound = nullptr;
+
+		while (q != nullptr) {
+			if (compare(key, q->_data) <= 0) {
+				bound = q;
+				q = q->_left;
 			} else {
-				return false;
+				q = q->_right;
 			}
 		}
 
-		while (!s.empty()) {
-			std::shared_ptr<gAVLNode<T>> p = s.top();
-
-			if (down && p->_left != nullptr) {
-				s.push(p->_left);
-				continue;
-			}
-
-			down = false;
-			s.pop();
+		return bound;
+	}
 
-			// test value
-			if (_comparator(p->_data, data) > 0 && condition(p->_data)) {
-				ref = p->_data;
-				return true;
-			}
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::upper_node(const K& key) const {
+		gAVLNode<T, Augment>* q = _root;
+		gAVLNode<T, Augment>* bound = nullptr;
 
-			if (p->_right != nullptr) {
-				s.push(p->_right);
-				down = true;
+		while (q != nullptr) {
+			if (compare(key, q->_data) < 0) {
+				bound = q;
+				q = q->_left;
+			} else {
+				q = q->_right;
 			}
 		}
-		
-		return false;
+
+		return bound;
 	}
 
-	template <typename T>
-	std::vector<T> gAVL<T>::to_stl_vector() {
-		std::vector<T> v;
-		std::stack<std::shared_ptr<gAVLNode<T>>> s;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename K>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::rank_node(const K& key, bool inclusive) const {
+		// Counts the values before key (or not after it, if inclusive), adding up every left subtree stepped over
+		const gAVLNode<T, Augment>* q = _root;
+		std::size_t r = 0;
 
-		if (_root != nullptr) {
-			s.push(_root);
+		while (q != nullptr) {
+			int comp = compare(key, q->_data);
+
+			if (comp < 0 || (comp == 0 && !inclusive)) {
+				q = q->_left;
+			} else {
+				r += count(q->_left) + 1;
+				q = q->_right;
+			}
 		}
 
-		bool down = true;
-		while (!s.empty()) {
-			std::shared_ptr<gAVLNode<T>> p = s.top();
+		return r;
+	}
 
-			if (down && p->_left != nullptr) {
-				s.push(p->_left);
-				continue;
-			}
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	std::size_t gAVL<T, Compare, Allocator, Augment, Stats>::count(const gAVLNode<T, Augment>* node) {
+		static_assert(std::is_base_of<gAVLCountAugment::node_data, typename Augment::node_data>::value, "Order statistics require the tree to be augmented with gAVLCountAugment");
 
-			down = false;
-			s.pop();
+		return (node != nullptr) ? node->_count : 0;
+	}
 
-			// push value
-			v.push_back(p->_data);
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	void gAVL<T, Compare, Allocator, Augment, Stats>::update_path(gAVLNode<T, Augment>* node) {
+		for (; node != nullptr; node = node->_parent) {
+			Augment::update(node);
+		}
+	}
 
-			if (p->_right != nullptr) {
-				s.push(p->_right);
-				down = true;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Node>
+	Node* gAVL<T, Compare, Allocator, Augment, Stats>::leftmost(Node* node) {
+		if (node != nullptr) {
+			while (node->_left != nullptr) {
+				node = node->_left;
 			}
 		}
 
-		return v;
+		return node;
 	}
 
-	template <typename T>
-	bool gAVL<T>::root(T& data) {
-		if (_root != nullptr) {
-			data = _root->_data;
-
-			return true;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Node>
+	Node* gAVL<T, Compare, Allocator, Augment, Stats>::rightmost(Node* node) {
+		if (node != nullptr) {
+			while (node->_right != nullptr) {
+				node = node->_right;
+			}
 		}
 
-		return false;
+		return node;
 	}
 
-	template <typename T>
-	bool gAVL<T>::search(const T& search_data, T& found_data) {
-		auto node = find(search_data);
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Node>
+	Node* gAVL<T, Compare, Allocator, Augment, Stats>::successor(Node* node) {
+		// Leftmost node of the right subtree, otherwise the first ancestor reached from its left side
+		if (node->_right != nullptr) {
+			return leftmost(static_cast<Node*>(node->_right));
+		}
 
-		if (node != nullptr && _comparator(search_data, node->_data) == 0) {
-			found_data = node->_data;
+		Node* p = node->_parent;
 
-			return true;
+		while (p != nullptr && node == p->_right) {
+			node = p;
+			p = p->_parent;
 		}
 
-		return false;
+		return p;
 	}
 
-	template <typename T>
-	std::shared_ptr<gAVLNode<T>> gAVL<T>::find(const T& data) {
-		std::shared_ptr<gAVLNode<T>> q = _root;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	template <typename Node>
+	Node* gAVL<T, Compare, Allocator, Augment, Stats>::predecessor(Node* node) {
+		// Mirror of successor
+		if (node->_left != nullptr) {
+			return rightmost(static_cast<Node*>(node->_left));
+		}
 
-		while (q != nullptr) {
-			int comp = _comparator(data, q->_data);
+		Node* p = node->_parent;
 
-			if (comp < 0) {
-				q = q->_left;
-			} else if (comp == 0) {
-				break;
-			} else {
-				q = q->_right;
-			}
+		while (p != nullptr && node == p->_left) {
+			node = p;
+			p = p->_parent;
 		}
 
-		return q;
+		return p;
 	}
 
-
 	/*
 		What follows is an adaptation of the pseudocode found at: https://en.wikipedia.org/wiki/AVL_tree
 		Or inverted psuedo-code (rotate_right and rotate_left_right are mirrored copies since they were presumed to be self-evident given the other two on the wiki, so the comments might not make sense)
 	*/
 
-	template <typename T>
-	void gAVL<T>::retrace_insert(std::shared_ptr<gAVLNode<T>> Z) {
-		std::shared_ptr<gAVLNode<T>> tmp = Z;
-		std::shared_ptr<gAVLNode<T>> N = nullptr;
-		std::shared_ptr<gAVLNode<T>> G = nullptr;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::retrace_insert(gAVLNode<T, Augment>* Z) {
+		gAVLNode<T, Augment>* N = nullptr;
+		gAVLNode<T, Augment>* G = nullptr;
+		int b = 0;
+
+		_stats.retraced();
 
-		for (std::shared_ptr<gAVLNode<T>> X = Z->_parent; X != nullptr; X = Z->_parent) { // Loop (possibly up to the root)
+		for (gAVLNode<T, Augment>* X = Z->_parent; X != nullptr; X = Z->_parent) { // Loop (possibly up to the root)
+			_stats.climbed();
 																						// balance_factor(X) has to be updated:
 			if (Z == X->_right) { // The right subtree increases
-				if (X->_balance_factor > 0) { // X is right-heavy
+				if (X->balance_factor() > 0) { // X is right-heavy
 											// ===> the temporary balance_factor(X) == +2
 											// ===> rebalancing is required.
 					G = X->_parent; // Save parent of X around rotations
-					if (Z->_balance_factor < 0)      // Right Left Case     (see figure 5)
+					b = Z->balance_factor();
+					if (Z->balance_factor() < 0)      // Right Left Case     (see figure 5)
 						N = rotate_right_left(X, Z); // Double rotation: Right(Z) then Left(X)
 					else                           // Right Right Case    (see figure 4)
 						N = rotate_left(X, Z);     // Single rotation Left(X)
 												// After rotation adapt parent link
 				} else {
-					if (X->_balance_factor < 0) {
-						X->_balance_factor = 0; // Z�s height increase is absorbed at X.
-						break; // Leave the loop
+					if (X->balance_factor() < 0) {
+						X->set_balance_factor(0); // Z�s height increase is absorbed at X.
+						return false; // Leave the loop
 					}
-					X->_balance_factor = +1;
+					X->set_balance_factor(+1);
 					Z = X; // Height(Z) increases by 1
 					continue;
 				}
 			} else { // Z == left_child(X): the left subtree increases
-				if (X->_balance_factor < 0) { // X is left-heavy
+				if (X->balance_factor() < 0) { // X is left-heavy
 											// ===> the temporary balance_factor(X) == �2
 											// ===> rebalancing is required.
 					G = X->_parent; // Save parent of X around rotations
-					if (Z->_balance_factor > 0)      // Left Right Case
+					b = Z->balance_factor();
+					if (Z->balance_factor() > 0)      // Left Right Case
 						N = rotate_left_right(X, Z); // Double rotation: Left(Z) then Right(X)
 					else                           // Left Left Case
 						N = rotate_right(X, Z);    // Single rotation Right(X)
 												// After rotation adapt parent link
 				} else {
-					if (X->_balance_factor > 0) {
-						X->_balance_factor = 0; // Z�s height increase is absorbed at X.
-						break; // Leave the loop
+					if (X->balance_factor() > 0) {
+						X->set_balance_factor(0); // Z�s height increase is absorbed at X.
+						return false; // Leave the loop
 					}
-					X->_balance_factor = -1;
+					X->set_balance_factor(-1);
 					Z = X; // Height(Z) increases by 1
 					continue;
 				}
@@ -699,67 +3861,73 @@ namespace bst {
 			// Height does not change: Height(N) == old Height(X)
 			N->_parent = G;
 			if (G != nullptr) {
+				link_traits::relinking(G);
 				if (X == G->_left)
 					G->_left = N;
 				else
 					G->_right = N;
-				break;
 			} else {
 				_root = N; // N is the new root of the total tree
-				break;
 			}
-			// There is no fall thru, only break; or continue;
+			if (b != 0)
+				return false; // Leave the loop
+			// BalanceFactor(Z) == 0 never happens with insertion, only when joining trees, and then the rotated subtree is still higher:
+			Z = N; // Height(N) == old Height(X) + 1
 		}
-		// Unless loop is left via break, the height of the total tree increases by 1.
+		// Unless loop is left via return, the height of the total tree increases by 1.
+		return true;
 	}
 
-	template <typename T>
-	void gAVL<T>::retrace_remove(std::shared_ptr<gAVLNode<T>> N) {
-		std::shared_ptr<gAVLNode<T>> G = nullptr;
-		std::shared_ptr<gAVLNode<T>> Z = nullptr;
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	bool gAVL<T, Compare, Allocator, Augment, Stats>::retrace_remove(gAVLNode<T, Augment>* N) {
+		gAVLNode<T, Augment>* G = nullptr;
+		gAVLNode<T, Augment>* Z = nullptr;
 		int b = 0;
 
-		for (std::shared_ptr<gAVLNode<T>> X = N->_parent; X != nullptr; X = G) { // Loop (possibly up to the root)
+		_stats.retraced();
+
+		for (gAVLNode<T, Augment>* X = N->_parent; X != nullptr; X = G) { // Loop (possibly up to the root)
+			_stats.climbed();
 			G = X->_parent; // Save parent of X around rotations
 						// BalanceFactor(X) has not yet been updated!
 			if (N == X->_left) { // the left subtree decreases
-				if (X->_balance_factor > 0) { // X is right-heavy
+				if (X->balance_factor() > 0) { // X is right-heavy
 											// ===> the temporary BalanceFactor(X) == +2
 											// ===> rebalancing is required.
 					Z = X->_right; // Sibling of N (higher by 2)
-					b = Z->_balance_factor;
+					b = Z->balance_factor();
 					if (b < 0)                     // Right Left Case     (see figure 5)
 						N = rotate_right_left(X, Z); // Double rotation: Right(Z) then Left(X)
 					else                           // Right Right Case    (see figure 4)
 						N = rotate_left(X, Z);     // Single rotation Left(X)
 												// After rotation adapt parent link
 				} else {
-					if (X->_balance_factor == 0) {
-						X->_balance_factor = +1; // N�s height decrease is absorbed at X.
-						break; // Leave the loop
+					if (X->balance_factor() == 0) {
+						X->set_balance_factor(+1); // N�s height decrease is absorbed at X.
+						return false; // Leave the loop
 					}
 					N = X;
-					N->_balance_factor = 0; // Height(N) decreases by 1
+					N->set_balance_factor(0); // Height(N) decreases by 1
 					continue;
 				}
 			} else { // (N == right_child(X)): The right subtree decreases
-				if (X->_balance_factor < 0) { // X is left-heavy
+				if (X->balance_factor() < 0) { // X is left-heavy
 											// ===> the temporary BalanceFactor(X) == �2
 											// ===> rebalancing is required.
 					Z = X->_left; // Sibling of N (higher by 2)
-					b = Z->_balance_factor;
+					b = Z->balance_factor();
 					if (b > 0)                     // Left Right Case
 						N = rotate_left_right(X, Z); // Double rotation: Left(Z) then Right(X)
 					else                        // Left Left Case
 						N = rotate_right(X, Z);    // Single rotation Right(X)
 												// After rotation adapt parent link
 				} else {
-					if (X->_balance_factor == 0) {
-						X->_balance_factor = -1; // N�s height decrease is absorbed at X.
-						break; // Leave the loop
+					if (X->balance_factor() == 0) {
+						X->set_balance_factor(-1); // N�s height decrease is absorbed at X.
+						return false; // Leave the loop
 					}
 					N = X;
-					N->_balance_factor = 0; // Height(N) decreases by 1
+					N->set_balance_factor(0); // Height(N) decreases by 1
 					continue;
 				}
 			}
@@ -767,24 +3935,30 @@ namespace bst {
 			// N is the new root of the rotated subtree
 			N->_parent = G;
 			if (G != nullptr) {
+				link_traits::relinking(G);
 				if (X == G->_left)
 					G->_left = N;
 				else
 					G->_right = N;
-				if (b == 0)
-					break; // Height does not change: Leave the loop
 			} else {
 				_root = N; // N is the new root of the total tree
 			}
+			if (b == 0)
+				return false; // Height does not change: Leave the loop
 			// Height(N) decreases by 1 (== old Height(X)-1)
 		}
-		// Unless loop is left via break, the height of the total tree decreases by 1.
+		// Unless loop is left via return, the height of the total tree decreases by 1.
+		return true;
 	}
 
-	template <typename T>
-	std::shared_ptr<gAVLNode<T>> gAVL<T>::rotate_right(std::shared_ptr<gAVLNode<T>> X, std::shared_ptr<gAVLNode<T>> Z) {
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::rotate_right(gAVLNode<T, Augment>* X, gAVLNode<T, Augment>* Z) {
+		_stats.rotated(gAVLRotation::Right);
+		link_traits::relinking(X);
+		link_traits::relinking(Z);
+
 		// Z is by 2 higher than its sibling
-		std::shared_ptr<gAVLNode<T>> t32 = Z->_right; // Inner child of Z
+		gAVLNode<T, Augment>* t32 = Z->_right; // Inner child of Z
 		X->_left = t32;
 
 		if (t32 != nullptr) {
@@ -795,21 +3969,28 @@ namespace bst {
 		X->_parent = Z;
 
 		// 1st case, BalanceFactor(Z) == 0, only happens with deletion, not insertion:
-		if (Z->_balance_factor == 0) { // t23 has been of same height as t4
-			X->_balance_factor = -1;   
-			Z->_balance_factor = +1;   
+		if (Z->balance_factor() == 0) { // t23 has been of same height as t4
+			X->set_balance_factor(-1);   
+			Z->set_balance_factor(+1);   
 		} else { // 2nd case happens with insertion or deletion:
-			X->_balance_factor = 0;
-			Z->_balance_factor = 0;
+			X->set_balance_factor(0);
+			Z->set_balance_factor(0);
 		}
 
+		Augment::update(X);
+		Augment::update(Z);
+
 		return Z; // return new root of rotated subtree
 	}
 
-	template <typename T>
-	std::shared_ptr<gAVLNode<T>> gAVL<T>::rotate_left(std::shared_ptr<gAVLNode<T>> X, std::shared_ptr<gAVLNode<T>> Z) {
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::rotate_left(gAVLNode<T, Augment>* X, gAVLNode<T, Augment>* Z) {
+		_stats.rotated(gAVLRotation::Left);
+		link_traits::relinking(X);
+		link_traits::relinking(Z);
+
 		// Z is by 2 higher than its sibling
-		std::shared_ptr<gAVLNode<T>> t23 = Z->_left; // Inner child of Z
+		gAVLNode<T, Augment>* t23 = Z->_left; // Inner child of Z
 		X->_right = t23;
 		
 		if (t23 != nullptr) {
@@ -820,23 +4001,32 @@ namespace bst {
 		X->_parent = Z;
 
 		// 1st case, BalanceFactor(Z) == 0, only happens with deletion, not insertion:
-		if (Z->_balance_factor == 0) { // t23 has been of same height as t4
-			X->_balance_factor = +1;   // t23 now higher
-			Z->_balance_factor = -1;   // t4 now lower than X
+		if (Z->balance_factor() == 0) { // t23 has been of same height as t4
+			X->set_balance_factor(+1);   // t23 now higher
+			Z->set_balance_factor(-1);   // t4 now lower than X
 		} else { // 2nd case happens with insertion or deletion:
-			X->_balance_factor = 0;
-			Z->_balance_factor = 0;
+			X->set_balance_factor(0);
+			Z->set_balance_factor(0);
 		}
 
+		Augment::update(X);
+		Augment::update(Z);
+
 		return Z; // return new root of rotated subtree
 	}
 
-	template <typename T>
-	std::shared_ptr<gAVLNode<T>> gAVL<T>::rotate_right_left(std::shared_ptr<gAVLNode<T>> X, std::shared_ptr<gAVLNode<T>> Z) {
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::rotate_right_left(gAVLNode<T, Augment>* X, gAVLNode<T, Augment>* Z) {
+		_stats.rotated(gAVLRotation::RightLeft);
+
 		// Z is by 2 higher than its sibling
-		std::shared_ptr<gAVLNode<T>> Y = Z->_left; // Inner child of Z
+		gAVLNode<T, Augment>* Y = Z->_left; // Inner child of Z
 												// Y is by 1 higher than sibling
-		std::shared_ptr<gAVLNode<T>> t3 = Y->_right;
+		link_traits::relinking(X);
+		link_traits::relinking(Z);
+		link_traits::relinking(Y);
+
+		gAVLNode<T, Augment>* t3 = Y->_right;
 		Z->_left = t3;
 
 		if (t3 != nullptr) {
@@ -845,7 +4035,7 @@ namespace bst {
 
 		Y->_right = Z;
 		Z->_parent = Y;
-		std::shared_ptr<gAVLNode<T>> t2 = Y->_left;
+		gAVLNode<T, Augment>* t2 = Y->_left;
 		X->_right = t2;
 
 		if (t2 != nullptr) {
@@ -856,30 +4046,40 @@ namespace bst {
 		X->_parent = Y;
 
 		// 1st case, BalanceFactor(Y) > 0, happens with insertion or deletion:
-		if (Y->_balance_factor > 0) { // t3 was higher
-			X->_balance_factor = -1;  // t1 now higher
-			Z->_balance_factor = 0;
+		if (Y->balance_factor() > 0) { // t3 was higher
+			X->set_balance_factor(-1);  // t1 now higher
+			Z->set_balance_factor(0);
 		} else { // 2nd case, BalanceFactor(Y) == 0, only happens with deletion, not insertion:
-			if (Y->_balance_factor == 0) {
-				X->_balance_factor = 0;
-				Z->_balance_factor = 0;
+			if (Y->balance_factor() == 0) {
+				X->set_balance_factor(0);
+				Z->set_balance_factor(0);
 			} else { // 3rd case happens with insertion or deletion:
 					// t2 was higher
-				X->_balance_factor = 0;
-				Z->_balance_factor = +1;  // t4 now higher
+				X->set_balance_factor(0);
+				Z->set_balance_factor(+1);  // t4 now higher
 			}
 		}
-		Y->_balance_factor = 0;
+		Y->set_balance_factor(0);
+
+		Augment::update(X);
+		Augment::update(Z);
+		Augment::update(Y);
 
 		return Y; // return new root of rotated subtree
 	}
 
-	template <typename T>
-	std::shared_ptr<gAVLNode<T>> gAVL<T>::rotate_left_right(std::shared_ptr<gAVLNode<T>> X, std::shared_ptr<gAVLNode<T>> Z) {
+	template <typename T, typename Compare, typename Allocator, typename Augment, typename Stats>
+	gAVLNode<T, Augment>* gAVL<T, Compare, Allocator, Augment, Stats>::rotate_left_right(gAVLNode<T, Augment>* X, gAVLNode<T, Augment>* Z) {
+		_stats.rotated(gAVLRotation::LeftRight);
+
 		// Z is by 2 higher than its sibling
-		std::shared_ptr<gAVLNode<T>> Y = Z->_right; // Inner child of Z
+		gAVLNode<T, Augment>* Y = Z->_right; // Inner child of Z
 												// Y is by 1 higher than sibling
-		std::shared_ptr<gAVLNode<T>> t3 = Y->_left;
+		link_traits::relinking(X);
+		link_traits::relinking(Z);
+		link_traits::relinking(Y);
+
+		gAVLNode<T, Augment>* t3 = Y->_left;
 		Z->_right = t3;
 
 		if (t3 != nullptr) {
@@ -888,7 +4088,7 @@ namespace bst {
 
 		Y->_left = Z;
 		Z->_parent = Y;
-		std::shared_ptr<gAVLNode<T>> t2 = Y->_right;
+		gAVLNode<T, Augment>* t2 = Y->_right;
 		X->_left = t2;
 
 		if (t2 != nullptr) {
@@ -899,19 +4099,23 @@ namespace bst {
 		X->_parent = Y;
 
 		// 1st case, BalanceFactor(Y) > 0, happens with insertion or deletion:
-		if (Y->_balance_factor < 0) { 
-			X->_balance_factor = +1;  
-			Z->_balance_factor = 0;
+		if (Y->balance_factor() < 0) { 
+			X->set_balance_factor(+1);  
+			Z->set_balance_factor(0);
 		} else { // 2nd case, BalanceFactor(Y) == 0, only happens with deletion, not insertion:
-			if (Y->_balance_factor == 0) {
-				X->_balance_factor = 0;
-				Z->_balance_factor = 0;
+			if (Y->balance_factor() == 0) {
+				X->set_balance_factor(0);
+				Z->set_balance_factor(0);
 			} else { // 3rd case happens with insertion or deletion:
-				X->_balance_factor = 0;
-				Z->_balance_factor = -1;  
+				X->set_balance_factor(0);
+				Z->set_balance_factor(-1);  
 			}
 		}
-		Y->_balance_factor = 0;
+		Y->set_balance_factor(0);
+
+		Augment::update(X);
+		Augment::update(Z);
+		Augment::update(Y);
 
 		return Y; // return new root of rotated subtree
 	}
@@ -0,0 +1,1042 @@
+#ifndef GAVLBTREE_H_
+#define GAVLBTREE_H_
+
+#include <gAVL.h>
+#include <gAVLSimd.h>
+
+namespace bst {
+	/*
+		Ordered set with the same interface as gAVL (insert, remove, contains, search, the search_* neighbour queries, iterators),
+		laid out as a B+-tree instead: every node holds as many values as fit in about NodeBytes, so a lookup touches a handful
+		of cache lines instead of one per level of a binary tree. The values live in the leaves, which are linked together for
+		the neighbour queries and iteration; the inner nodes hold copies of some of them as separators, so T has to be copyable.
+	*/
+	template <typename T, typename Compare = gAVLCompare<T>, typename Allocator = std::allocator<T>, std::size_t NodeBytes = 128>
+	class gAVLBTree {
+		protected:
+			struct Node {
+				unsigned short _count;				// Values (leaf) or separators (inner node) held
+				bool _leaf;
+			};
+
+			typedef typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type Slot;
+
+		public:
+			typedef Compare comparator_type;
+			typedef Allocator allocator_type;
+
+			// Fan-out, at least 4 whatever the size of T
+			static const std::size_t leaf_capacity = (NodeBytes > sizeof(Node) + 2 * sizeof(void*) + 4 * sizeof(T)) ? (NodeBytes - sizeof(Node) - 2 * sizeof(void*)) / sizeof(T) : 4;
+			static const std::size_t inner_capacity = (NodeBytes > sizeof(Node) + sizeof(void*) + 4 * (sizeof(T) + sizeof(void*))) ? (NodeBytes - sizeof(Node) - sizeof(void*)) / (sizeof(T) + sizeof(void*)) : 4;
+
+			explicit gAVLBTree(const Compare& comparator = Compare(), const Allocator& allocator = Allocator());
+			gAVLBTree(const gAVLBTree& other);
+			gAVLBTree(gAVLBTree&& other);
+			~gAVLBTree();
+
+			gAVLBTree& operator=(const gAVLBTree& other);
+			gAVLBTree& operator=(gAVLBTree&& other);
+
+			enum Position {
+				Before,
+				After,
+				Equal
+			};
+
+		protected:
+			struct Leaf : public Node {
+				Leaf* _prev;
+				Leaf* _next;
+				Slot _slots[leaf_capacity + 1];		// One spare, to overflow into right before splitting
+			};
+
+			struct Inner : public Node {
+				Slot _slots[inner_capacity + 1];
+				Node* _children[inner_capacity + 2];
+			};
+
+		public:
+			class const_iterator {
+				public:
+					typedef std::bidirectional_iterator_tag iterator_category;
+					typedef T value_type;
+					typedef std::ptrdiff_t difference_type;
+					typedef const T* pointer;
+					typedef const T& reference;
+
+					const_iterator() : _leaf(nullptr), _index(0), _tree(nullptr) {}
+
+					reference operator*() const { return gAVLBTree::value(_leaf, _index); }
+					pointer operator->() const { return &gAVLBTree::value(_leaf, _index); }
+
+					const_iterator& operator++() {
+						if (++_index == _leaf->_count) {
+							_leaf = _leaf->_next;
+							_index = 0;
+						}
+
+						return *this;
+					}
+
+					const_iterator operator++(int) {
+						const_iterator it = *this;
+						++(*this);
+
+						return it;
+					}
+
+					const_iterator& operator--() {
+						if (_leaf == nullptr) {
+							// From end(), onto the last value
+							_leaf = _tree->last_leaf();
+							_index = _leaf->_count;
+						} else if (_index == 0) {
+							_leaf = _leaf->_prev;
+							_index = _leaf->_count;
+						}
+
+						_index--;
+
+						return *this;
+					}
+
+					const_iterator operator--(int) {
+						const_iterator it = *this;
+						--(*this);
+
+						return it;
+					}
+
+					bool operator==(const const_iterator& other) const { return _leaf == other._leaf && _index == other._index; }
+					bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+				protected:
+					const_iterator(const Leaf* leaf, std::size_t index, const gAVLBTree* tree) : _leaf(leaf), _index(index), _tree(tree) {
+						// One past the end of a leaf is the start of the next one
+						if (_leaf != nullptr && _index == _leaf->_count) {
+							_leaf = _leaf->_next;
+							_index = 0;
+						}
+					}
+
+					const Leaf* _leaf;
+					std::size_t _index;
+					const gAVLBTree* _tree;
+
+					friend class gAVLBTree;
+			};
+
+			typedef const_iterator iterator;
+			typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+			typedef const_reverse_iterator reverse_iterator;
+
+			bool insert(const T& data);				// Adds the data value to the tree (if it already exists in the tree, does nothing) [O(log(n))]
+			bool insert(T&& data);					// Same as above, moving data into the tree instead of copying it [O(log(n))]
+			bool remove(const T& data);				// Removes the data value from the tree (if it does not exist in the tree does nothing) [O(log(n))]
+
+			std::size_t size() const;				// Returns the number of items stored in the tree [O(1)]
+			int height() const;						// Returns the number of levels of nodes [O(log(n))]
+			bool contains(const T& data) const;		// Returns true if the data value is contained in the tree, false otherwise [O(log(n))]
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> bool contains(const K& key) const;
+			bool search(const T& search_data, T& found_data) const;
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> bool search(const K& search_key, T& found_data) const;
+			template <typename Condition = gAVLAlways> bool search_neighbors(const T& data, std::map<Position,T>& ref, Condition condition = Condition()) const;	// Worst case [O(n)], typically far better
+			template <typename Condition = gAVLAlways> bool search_before(const T& data, T& ref, Condition condition = Condition()) const;	// Worst case [O(n)], typically far better
+			template <typename Condition = gAVLAlways> bool search_after(const T& data, T& ref, Condition condition = Condition()) const;	// Worst case [O(n)], typically far better
+
+			std::vector<T> to_stl_vector() const;	// Returns the tree as an ordered vector [O(n)]
+
+			const_iterator begin() const;			// [O(log(n))]
+			const_iterator end() const;				// [O(1)]
+			const_iterator cbegin() const;
+			const_iterator cend() const;
+			const_reverse_iterator rbegin() const;
+			const_reverse_iterator rend() const;
+			const_iterator lower_bound(const T& data) const;	// Position of the first value not before data, or end() [O(log(n))]
+			const_iterator upper_bound(const T& data) const;	// Position of the first value after data, or end() [O(log(n))]
+			void clear();							// Removes every item from the tree [O(n)]
+			allocator_type get_allocator() const;
+
+		protected:
+			typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Leaf> leaf_allocator_type;
+			typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Inner> inner_allocator_type;
+			typedef std::allocator_traits<leaf_allocator_type> leaf_traits;
+			typedef std::allocator_traits<inner_allocator_type> inner_traits;
+
+			static const std::size_t leaf_minimum = leaf_capacity / 2;
+			static const std::size_t inner_minimum = inner_capacity / 2;
+
+			template <typename N> static T& value(N* node, std::size_t i);
+			template <typename N> static const T& value(const N* node, std::size_t i);
+			template <typename N> static void relocate(N* to, std::size_t i, N* from, std::size_t j);	// Moves value j of from into the (empty) slot i of to
+			template <typename N> static void shift(N* node, std::size_t i, std::ptrdiff_t by);		// Moves the values from slot i on by slots
+			static void shift_children(Inner* node, std::size_t i, std::ptrdiff_t by);
+
+			Leaf* create_leaf();
+			Inner* create_inner();
+			void destroy(Node* node);					// Frees node along with everything under it
+			void destroy_node(Node* node);				// Frees node alone (its values have to be gone)
+			Node* clone(const Node* node, Leaf*& previous);
+
+			template <typename K, typename N> std::size_t lower_index(const N* node, const K& key) const;	// First slot not before key
+			template <typename K> std::size_t child_index(const Inner* node, const K& key) const;	// Child whose range holds key
+			template <typename K, typename N> std::size_t rank(const N* node, const K& key, bool inclusive, std::false_type) const;	// Slots before key (or not after it, if inclusive) by binary search
+			template <typename K, typename N> std::size_t rank(const N* node, const K& key, bool inclusive, std::true_type) const;	// Same, by gAVLSimdRank, for arithmetic T in its natural order
+			template <typename K> const Leaf* find_leaf(const K& key, std::size_t& index) const;		// Leaf and slot of the first value not before key
+			template <typename K> const T* find(const K& key) const;
+			const Leaf* first_leaf() const;
+			const Leaf* last_leaf() const;
+
+			template <typename V> bool insert_value(V&& data);
+			template <typename V> bool insert(Node* node, V&& data, Node*& split, Slot& separator);	// split (and separator, constructed) is set if node had to split
+			Leaf* split_leaf(Leaf* leaf, Slot& separator);
+			Inner* split_inner(Inner* inner, Slot& separator);
+			bool remove(Node* node, const T& data);
+			void rebalance(Inner* parent, std::size_t i);	// Child i of parent is one short of its minimum
+			void merge(Inner* parent, std::size_t i);		// Merges child i + 1 of parent into child i
+
+			Compare _comparator;
+			Node* _root;
+			std::size_t _size;
+			leaf_allocator_type _leaf_allocator;
+			inner_allocator_type _inner_allocator;
+	};
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	const std::size_t gAVLBTree<T, Compare, Allocator, NodeBytes>::leaf_capacity;
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	const std::size_t gAVLBTree<T, Compare, Allocator, NodeBytes>::inner_capacity;
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	const std::size_t gAVLBTree<T, Compare, Allocator, NodeBytes>::leaf_minimum;
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	const std::size_t gAVLBTree<T, Compare, Allocator, NodeBytes>::inner_minimum;
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	gAVLBTree<T, Compare, Allocator, NodeBytes>::gAVLBTree(const Compare& comparator, const Allocator& allocator) : _comparator(comparator), _root(nullptr), _size(0), _leaf_allocator(allocator), _inner_allocator(allocator) {
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	gAVLBTree<T, Compare, Allocator, NodeBytes>::gAVLBTree(const gAVLBTree& other) : _comparator(other._comparator), _root(nullptr), _size(0), _leaf_allocator(leaf_traits::select_on_container_copy_construction(other._leaf_allocator)), _inner_allocator(inner_traits::select_on_container_copy_construction(other._inner_allocator)) {
+		Leaf* previous = nullptr;
+
+		_root = clone(other._root, previous);
+		_size = other._size;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	gAVLBTree<T, Compare, Allocator, NodeBytes>::gAVLBTree(gAVLBTree&& other) : _comparator(std::move(other._comparator)), _root(other._root), _size(other._size), _leaf_allocator(std::move(other._leaf_allocator)), _inner_allocator(std::move(other._inner_allocator)) {
+		other._root = nullptr;
+		other._size = 0;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	gAVLBTree<T, Compare, Allocator, NodeBytes>::~gAVLBTree() {
+		clear();
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	gAVLBTree<T, Compare, Allocator, NodeBytes>& gAVLBTree<T, Compare, Allocator, NodeBytes>::operator=(const gAVLBTree& other) {
+		if (this != &other) {
+			gAVLBTree tmp(other);
+			*this = std::move(tmp);
+		}
+
+		return *this;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	gAVLBTree<T, Compare, Allocator, NodeBytes>& gAVLBTree<T, Compare, Allocator, NodeBytes>::operator=(gAVLBTree&& other) {
+		if (this != &other) {
+			clear();
+
+			_comparator = std::move(other._comparator);
+			_leaf_allocator = std::move(other._leaf_allocator);
+			_inner_allocator = std::move(other._inner_allocator);
+			_root = other._root;
+			_size = other._size;
+
+			other._root = nullptr;
+			other._size = 0;
+		}
+
+		return *this;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	bool gAVLBTree<T, Compare, Allocator, NodeBytes>::insert(const T& data) {
+		return insert_value(data);
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	bool gAVLBTree<T, Compare, Allocator, NodeBytes>::insert(T&& data) {
+		return insert_value(std::move(data));
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	bool gAVLBTree<T, Compare, Allocator, NodeBytes>::remove(const T& data) {
+		if (_root == nullptr || !remove(_root, data)) {
+			return false;
+		}
+
+		_size--;
+
+		// The tree shrinks from the top: a root left without separators hands over to its only child
+		if (!_root->_leaf && _root->_count == 0) {
+			Node* child = static_cast<Inner*>(_root)->_children[0];
+
+			destroy_node(_root);
+			_root = child;
+		} else if (_root->_leaf && _root->_count == 0) {
+			destroy_node(_root);
+			_root = nullptr;
+		}
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	std::size_t gAVLBTree<T, Compare, Allocator, NodeBytes>::size() const {
+		return _size;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	int gAVLBTree<T, Compare, Allocator, NodeBytes>::height() const {
+		// Every leaf is at the same depth
+		int h = 0;
+
+		for (const Node* p = _root; p != nullptr; p = p->_leaf ? nullptr : static_cast<const Inner*>(p)->_children[0]) {
+			h++;
+		}
+
+		return h;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	bool gAVLBTree<T, Compare, Allocator, NodeBytes>::contains(const T& data) const {
+		return find(data) != nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename K, typename C, typename>
+	bool gAVLBTree<T, Compare, Allocator, NodeBytes>::contains(const K& key) const {
+		return find(key) != nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	bool gAVLBTree<T, Compare, Allocator, NodeBytes>::search(const T& search_data, T& found_data) const {
+		const T* found = find(search_data);
+
+		if (found == nullptr) {
+			return false;
+		}
+
+		found_data = *found;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename K, typename C, typename>
+	bool gAVLBTree<T, Compare, Allocator, NodeBytes>::search(const K& search_key, T& found_data) const {
+		const T* found = find(search_key);
+
+		if (found == nullptr) {
+			return false;
+		}
+
+		found_data = *found;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename Condition>
+	bool gAVLBTree<T, Compare, Allocator, NodeBytes>::search_neighbors(const T& data, std::map<Position,T>& ref, Condition condition) const {
+		// One descent: the insertion point is the equal value if there is one, Before is scanned for from it backwards and After
+		// from it (or past the equal value) forwards
+		std::size_t s = ref.size();
+		const const_iterator position = lower_bound(data);
+		const const_iterator first = begin();
+		const const_iterator last = end();
+		const_iterator after = position;
+
+		if (position != last && _comparator(data, *position) == 0) {
+			ref.insert(std::pair<Position, T>(Equal, *position));
+			++after;
+		}
+
+		for (const_iterator it = position; it != first; ) {
+			--it;
+
+			if (condition(*it)) {
+				ref.insert(std::pair<Position, T>(Before, *it));
+				break;
+			}
+		}
+
+		for (; after != last; ++after) {
+			if (condition(*after)) {
+				ref.insert(std::pair<Position, T>(After, *after));
+				break;
+			}
+		}
+
+		return ref.size() > s;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename Condition>
+	bool gAVLBTree<T, Compare, Allocator, NodeBytes>::search_before(const T& data, T& ref, Condition condition) const {
+		// Backwards along the leaves from the insertion point until a value satisfies the condition
+		const const_iterator first = begin();
+
+		for (const_iterator it = lower_bound(data); it != first; ) {
+			--it;
+
+			if (condition(*it)) {
+				ref = *it;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename Condition>
+	bool gAVLBTree<T, Compare, Allocator, NodeBytes>::search_after(const T& data, T& ref, Condition condition) const {
+		for (const_iterator it = upper_bound(data); it != end(); ++it) {
+			if (condition(*it)) {
+				ref = *it;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	std::vector<T> gAVLBTree<T, Compare, Allocator, NodeBytes>::to_stl_vector() const {
+		std::vector<T> v;
+		v.reserve(_size);
+
+		for (const Leaf* leaf = first_leaf(); leaf != nullptr; leaf = leaf->_next) {
+			for (std::size_t i = 0; i < leaf->_count; ++i) {
+				v.push_back(value(leaf, i));
+			}
+		}
+
+		return v;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::const_iterator gAVLBTree<T, Compare, Allocator, NodeBytes>::begin() const {
+		return const_iterator(first_leaf(), 0, this);
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::const_iterator gAVLBTree<T, Compare, Allocator, NodeBytes>::end() const {
+		return const_iterator(nullptr, 0, this);
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::const_iterator gAVLBTree<T, Compare, Allocator, NodeBytes>::cbegin() const {
+		return begin();
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::const_iterator gAVLBTree<T, Compare, Allocator, NodeBytes>::cend() const {
+		return end();
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::const_reverse_iterator gAVLBTree<T, Compare, Allocator, NodeBytes>::rbegin() const {
+		return const_reverse_iterator(end());
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::const_reverse_iterator gAVLBTree<T, Compare, Allocator, NodeBytes>::rend() const {
+		return const_reverse_iterator(begin());
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::const_iterator gAVLBTree<T, Compare, Allocator, NodeBytes>::lower_bound(const T& data) const {
+		std::size_t i = 0;
+		const Leaf* leaf = find_leaf(data, i);
+
+		return const_iterator(leaf, i, this);
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::const_iterator gAVLBTree<T, Compare, Allocator, NodeBytes>::upper_bound(const T& data) const {
+		const_iterator it = lower_bound(data);
+
+		if (it != end() && _comparator(data, *it) == 0) {
+			++it;
+		}
+
+		return it;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	void gAVLBTree<T, Compare, Allocator, NodeBytes>::clear() {
+		if (_root != nullptr) {
+			destroy(_root);
+		}
+
+		_root = nullptr;
+		_size = 0;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::allocator_type gAVLBTree<T, Compare, Allocator, NodeBytes>::get_allocator() const {
+		return allocator_type(_leaf_allocator);
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename N>
+	T& gAVLBTree<T, Compare, Allocator, NodeBytes>::value(N* node, std::size_t i) {
+		return *reinterpret_cast<T*>(&node->_slots[i]);
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename N>
+	const T& gAVLBTree<T, Compare, Allocator, NodeBytes>::value(const N* node, std::size_t i) {
+		return *reinterpret_cast<const T*>(&node->_slots[i]);
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename N>
+	void gAVLBTree<T, Compare, Allocator, NodeBytes>::relocate(N* to, std::size_t i, N* from, std::size_t j) {
+		::new (static_cast<void*>(&to->_slots[i])) T(std::move(value(from, j)));
+		value(from, j).~T();
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename N>
+	void gAVLBTree<T, Compare, Allocator, NodeBytes>::shift(N* node, std::size_t i, std::ptrdiff_t by) {
+		// Moving right goes from the last value down, moving left from i up, so no value is overwritten before it is moved
+		if (by > 0) {
+			for (std::size_t j = node->_count; j-- > i; ) {
+				relocate(node, j + by, node, j);
+			}
+		} else {
+			for (std::size_t j = i; j < node->_count; ++j) {
+				relocate(node, j + by, node, j);
+			}
+		}
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	void gAVLBTree<T, Compare, Allocator, NodeBytes>::shift_children(Inner* node, std::size_t i, std::ptrdiff_t by) {
+		// Children i to _count (inclusive)
+		if (by > 0) {
+			for (std::size_t j = node->_count + 1; j-- > i; ) {
+				node->_children[j + by] = node->_children[j];
+			}
+		} else {
+			for (std::size_t j = i; j <= node->_count; ++j) {
+				node->_children[j + by] = node->_children[j];
+			}
+		}
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::Leaf* gAVLBTree<T, Compare, Allocator, NodeBytes>::create_leaf() {
+		Leaf* leaf = leaf_traits::allocate(_leaf_allocator, 1);
+		leaf_traits::construct(_leaf_allocator, leaf);
+
+		leaf->_count = 0;
+		leaf->_leaf = true;
+		leaf->_prev = leaf->_next = nullptr;
+
+		return leaf;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::Inner* gAVLBTree<T, Compare, Allocator, NodeBytes>::create_inner() {
+		Inner* inner = inner_traits::allocate(_inner_allocator, 1);
+		inner_traits::construct(_inner_allocator, inner);
+
+		inner->_count = 0;
+		inner->_leaf = false;
+
+		return inner;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	void gAVLBTree<T, Compare, Allocator, NodeBytes>::destroy(Node* node) {
+		if (node->_leaf) {
+			Leaf* leaf = static_cast<Leaf*>(node);
+
+			for (std::size_t i = 0; i < leaf->_count; ++i) {
+				value(leaf, i).~T();
+			}
+		} else {
+			Inner* inner = static_cast<Inner*>(node);
+
+			for (std::size_t i = 0; i <= inner->_count; ++i) {
+				destroy(inner->_children[i]);
+			}
+
+			for (std::size_t i = 0; i < inner->_count; ++i) {
+				value(inner, i).~T();
+			}
+		}
+
+		node->_count = 0;
+		destroy_node(node);
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	void gAVLBTree<T, Compare, Allocator, NodeBytes>::destroy_node(Node* node) {
+		if (node->_leaf) {
+			Leaf* leaf = static_cast<Leaf*>(node);
+
+			leaf_traits::destroy(_leaf_allocator, leaf);
+			leaf_traits::deallocate(_leaf_allocator, leaf, 1);
+		} else {
+			Inner* inner = static_cast<Inner*>(node);
+
+			inner_traits::destroy(_inner_allocator, inner);
+			inner_traits::deallocate(_inner_allocator, inner, 1);
+		}
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::Node* gAVLBTree<T, Compare, Allocator, NodeBytes>::clone(const Node* node, Leaf*& previous) {
+		// Depth first, so the leaves come out in order and get linked up as they go
+		if (node == nullptr) {
+			return nullptr;
+		}
+
+		if (node->_leaf) {
+			const Leaf* leaf = static_cast<const Leaf*>(node);
+			Leaf* copy = create_leaf();
+
+			for (; copy->_count < leaf->_count; copy->_count++) {
+				::new (static_cast<void*>(&copy->_slots[copy->_count])) T(value(leaf, copy->_count));
+			}
+
+			copy->_prev = previous;
+
+			if (previous != nullptr) {
+				previous->_next = copy;
+			}
+
+			previous = copy;
+
+			return copy;
+		}
+
+		const Inner* inner = static_cast<const Inner*>(node);
+		Inner* copy = create_inner();
+
+		for (std::size_t i = 0; i <= inner->_count; ++i) {
+			copy->_children[i] = clone(inner->_children[i], previous);
+		}
+
+		for (; copy->_count < inner->_count; copy->_count++) {
+			::new (static_cast<void*>(&copy->_slots[copy->_count])) T(value(inner, copy->_count));
+		}
+
+		return copy;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename K, typename N>
+	std::size_t gAVLBTree<T, Compare, Allocator, NodeBytes>::lower_index(const N* node, const K& key) const {
+		return rank(node, key, false, std::integral_constant<bool, gAVLSimdOrdered<T, Compare>::value && std::is_same<K, T>::value>());
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename K>
+	std::size_t gAVLBTree<T, Compare, Allocator, NodeBytes>::child_index(const Inner* node, const K& key) const {
+		// Child i holds the values in [separator i - 1, separator i)
+		return rank(node, key, true, std::integral_constant<bool, gAVLSimdOrdered<T, Compare>::value && std::is_same<K, T>::value>());
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename K, typename N>
+	std::size_t gAVLBTree<T, Compare, Allocator, NodeBytes>::rank(const N* node, const K& key, bool inclusive, std::false_type) const {
+		// Binary search over the slots of a single node, all of them a cache line or two away at most
+		std::size_t lo = 0;
+		std::size_t hi = node->_count;
+
+		while (lo < hi) {
+			std::size_t mid = lo + (hi - lo) / 2;
+			int c = _comparator(key, value(node, mid));
+
+			if (c > 0 || (inclusive && c == 0)) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+
+		return lo;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename K, typename N>
+	std::size_t gAVLBTree<T, Compare, Allocator, NodeBytes>::rank(const N* node, const K& key, bool inclusive, std::true_type) const {
+		// The slots of a node are contiguous, so its keys sit side by side in one or two cache lines
+		return gAVLSimdRank<T>::count(&value(node, 0), node->_count, key, inclusive);
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename K>
+	const typename gAVLBTree<T, Compare, Allocator, NodeBytes>::Leaf* gAVLBTree<T, Compare, Allocator, NodeBytes>::find_leaf(const K& key, std::size_t& index) const {
+		const Node* p = _root;
+
+		if (p == nullptr) {
+			index = 0;
+			return nullptr;
+		}
+
+		while (!p->_leaf) {
+			const Inner* inner = static_cast<const Inner*>(p);
+			p = inner->_children[child_index(inner, key)];
+		}
+
+		const Leaf* leaf = static_cast<const Leaf*>(p);
+		index = lower_index(leaf, key);
+
+		return leaf;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename K>
+	const T* gAVLBTree<T, Compare, Allocator, NodeBytes>::find(const K& key) const {
+		std::size_t i = 0;
+		const Leaf* leaf = find_leaf(key, i);
+
+		if (leaf == nullptr || i == leaf->_count || _comparator(key, value(leaf, i)) != 0) {
+			return nullptr;
+		}
+
+		return &value(leaf, i);
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	const typename gAVLBTree<T, Compare, Allocator, NodeBytes>::Leaf* gAVLBTree<T, Compare, Allocator, NodeBytes>::first_leaf() const {
+		const Node* p = _root;
+
+		while (p != nullptr && !p->_leaf) {
+			p = static_cast<const Inner*>(p)->_children[0];
+		}
+
+		return static_cast<const Leaf*>(p);
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	const typename gAVLBTree<T, Compare, Allocator, NodeBytes>::Leaf* gAVLBTree<T, Compare, Allocator, NodeBytes>::last_leaf() const {
+		const Node* p = _root;
+
+		while (p != nullptr && !p->_leaf) {
+			p = static_cast<const Inner*>(p)->_children[p->_count];
+		}
+
+		return static_cast<const Leaf*>(p);
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename V>
+	bool gAVLBTree<T, Compare, Allocator, NodeBytes>::insert_value(V&& data) {
+		if (_root == nullptr) {
+			_root = create_leaf();
+		}
+
+		Node* split = nullptr;
+		Slot separator;
+
+		if (!insert(_root, std::forward<V>(data), split, separator)) {
+			return false;
+		}
+
+		_size++;
+
+		if (split != nullptr) {
+			// The tree grows from the top: a new root over the two halves of the old one
+			Inner* root = create_inner();
+
+			::new (static_cast<void*>(&root->_slots[0])) T(std::move(*reinterpret_cast<T*>(&separator)));
+			reinterpret_cast<T*>(&separator)->~T();
+
+			root->_count = 1;
+			root->_children[0] = _root;
+			root->_children[1] = split;
+
+			_root = root;
+		}
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	template <typename V>
+	bool gAVLBTree<T, Compare, Allocator, NodeBytes>::insert(Node* node, V&& data, Node*& split, Slot& separator) {
+		if (node->_leaf) {
+			Leaf* leaf = static_cast<Leaf*>(node);
+			std::size_t i = lower_index(leaf, data);
+
+			if (i < leaf->_count && _comparator(data, value(leaf, i)) == 0) {
+				return false;
+			}
+
+			::new (static_cast<void*>(&leaf->_slots[leaf->_count])) T(std::forward<V>(data));
+
+			// Rotate the new value from the end into place
+			if (i < leaf->_count) {
+				Slot spare;
+
+				::new (static_cast<void*>(&spare)) T(std::move(value(leaf, leaf->_count)));
+				value(leaf, leaf->_count).~T();
+				shift(leaf, i, 1);
+				::new (static_cast<void*>(&leaf->_slots[i])) T(std::move(*reinterpret_cast<T*>(&spare)));
+				reinterpret_cast<T*>(&spare)->~T();
+			}
+
+			leaf->_count++;
+
+			if (leaf->_count > leaf_capacity) {
+				split = split_leaf(leaf, separator);
+			}
+
+			return true;
+		}
+
+		Inner* inner = static_cast<Inner*>(node);
+		std::size_t i = child_index(inner, data);
+		Node* child_split = nullptr;
+		Slot child_separator;
+
+		if (!insert(inner->_children[i], std::forward<V>(data), child_split, child_separator)) {
+			return false;
+		}
+
+		if (child_split != nullptr) {
+			// The new half goes right of child i, separated from it by child_separator
+			shift(inner, i, 1);
+			shift_children(inner, i + 1, 1);
+
+			::new (static_cast<void*>(&inner->_slots[i])) T(std::move(*reinterpret_cast<T*>(&child_separator)));
+			reinterpret_cast<T*>(&child_separator)->~T();
+
+			inner->_children[i + 1] = child_split;
+			inner->_count++;
+
+			if (inner->_count > inner_capacity) {
+				split = split_inner(inner, separator);
+			}
+		}
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::Leaf* gAVLBTree<T, Compare, Allocator, NodeBytes>::split_leaf(Leaf* leaf, Slot& separator) {
+		// The upper half moves to a new leaf, whose first value (copied) separates the two
+		Leaf* right = create_leaf();
+		std::size_t mid = leaf->_count / 2;
+
+		for (std::size_t j = mid; j < leaf->_count; ++j) {
+			relocate(right, j - mid, leaf, j);
+		}
+
+		right->_count = static_cast<unsigned short>(leaf->_count - mid);
+		leaf->_count = static_cast<unsigned short>(mid);
+
+		right->_next = leaf->_next;
+		right->_prev = leaf;
+
+		if (leaf->_next != nullptr) {
+			leaf->_next->_prev = right;
+		}
+
+		leaf->_next = right;
+
+		::new (static_cast<void*>(&separator)) T(value(right, 0));
+
+		return right;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	typename gAVLBTree<T, Compare, Allocator, NodeBytes>::Inner* gAVLBTree<T, Compare, Allocator, NodeBytes>::split_inner(Inner* inner, Slot& separator) {
+		// The middle separator moves up, the ones after it (and their children) to a new node
+		Inner* right = create_inner();
+		std::size_t mid = inner->_count / 2;
+
+		for (std::size_t j = mid + 1; j < inner->_count; ++j) {
+			relocate(right, j - mid - 1, inner, j);
+		}
+
+		for (std::size_t j = mid + 1; j <= inner->_count; ++j) {
+			right->_children[j - mid - 1] = inner->_children[j];
+		}
+
+		right->_count = static_cast<unsigned short>(inner->_count - mid - 1);
+
+		::new (static_cast<void*>(&separator)) T(std::move(value(inner, mid)));
+		value(inner, mid).~T();
+
+		inner->_count = static_cast<unsigned short>(mid);
+
+		return right;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	bool gAVLBTree<T, Compare, Allocator, NodeBytes>::remove(Node* node, const T& data) {
+		if (node->_leaf) {
+			Leaf* leaf = static_cast<Leaf*>(node);
+			std::size_t i = lower_index(leaf, data);
+
+			if (i == leaf->_count || _comparator(data, value(leaf, i)) != 0) {
+				return false;
+			}
+
+			value(leaf, i).~T();
+			shift(leaf, i + 1, -1);
+			leaf->_count--;
+
+			return true;
+		}
+
+		// Separators equal to the removed value can stay, they still separate the same ranges
+		Inner* inner = static_cast<Inner*>(node);
+		std::size_t i = child_index(inner, data);
+		Node* child = inner->_children[i];
+
+		if (!remove(child, data)) {
+			return false;
+		}
+
+		if (child->_count < (child->_leaf ? leaf_minimum : inner_minimum)) {
+			rebalance(inner, i);
+		}
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	void gAVLBTree<T, Compare, Allocator, NodeBytes>::rebalance(Inner* parent, std::size_t i) {
+		// Borrow a value from a sibling that can spare one, otherwise merge with one
+		Node* child = parent->_children[i];
+		Node* left = (i > 0) ? parent->_children[i - 1] : nullptr;
+		Node* right = (i < parent->_count) ? parent->_children[i + 1] : nullptr;
+		std::size_t minimum = child->_leaf ? leaf_minimum : inner_minimum;
+
+		if (left != nullptr && left->_count > minimum) {
+			if (child->_leaf) {
+				// The last value of left becomes the first of child, and the new separator
+				Leaf* c = static_cast<Leaf*>(child);
+				Leaf* l = static_cast<Leaf*>(left);
+
+				shift(c, 0, 1);
+				relocate(c, 0, l, l->_count - 1);
+				c->_count++;
+				l->_count--;
+
+				value(parent, i - 1) = value(c, 0);
+			} else {
+				// Rotate through the parent: its separator comes down in front of child, the last one of left goes up
+				Inner* c = static_cast<Inner*>(child);
+				Inner* l = static_cast<Inner*>(left);
+
+				shift(c, 0, 1);
+				shift_children(c, 0, 1);
+				relocate(c, 0, parent, i - 1);
+				c->_children[0] = l->_children[l->_count];
+				c->_count++;
+
+				relocate(parent, i - 1, l, l->_count - 1);
+				l->_count--;
+			}
+		} else if (right != nullptr && right->_count > minimum) {
+			if (child->_leaf) {
+				Leaf* c = static_cast<Leaf*>(child);
+				Leaf* r = static_cast<Leaf*>(right);
+
+				relocate(c, c->_count, r, 0);
+				shift(r, 1, -1);
+				c->_count++;
+				r->_count--;
+
+				value(parent, i) = value(r, 0);
+			} else {
+				Inner* c = static_cast<Inner*>(child);
+				Inner* r = static_cast<Inner*>(right);
+
+				relocate(c, c->_count, parent, i);
+				c->_children[c->_count + 1] = r->_children[0];
+				c->_count++;
+
+				relocate(parent, i, r, 0);
+				shift(r, 1, -1);
+				shift_children(r, 1, -1);
+				r->_count--;
+			}
+		} else if (left != nullptr) {
+			merge(parent, i - 1);
+		} else {
+			merge(parent, i);
+		}
+	}
+
+	template <typename T, typename Compare, typename Allocator, std::size_t NodeBytes>
+	void gAVLBTree<T, Compare, Allocator, NodeBytes>::merge(Inner* parent, std::size_t i) {
+		Node* left = parent->_children[i];
+		Node* right = parent->_children[i + 1];
+
+		if (left->_leaf) {
+			// Leaves don't need the separator, it's dropped
+			Leaf* l = static_cast<Leaf*>(left);
+			Leaf* r = static_cast<Leaf*>(right);
+
+			for (std::size_t j = 0; j < r->_count; ++j) {
+				relocate(l, l->_count + j, r, j);
+			}
+
+			l->_count = static_cast<unsigned short>(l->_count + r->_count);
+			r->_count = 0;
+
+			l->_next = r->_next;
+
+			if (r->_next != nullptr) {
+				r->_next->_prev = l;
+			}
+
+			value(parent, i).~T();
+		} else {
+			// Inner nodes take it down between their separators
+			Inner* l = static_cast<Inner*>(left);
+			Inner* r = static_cast<Inner*>(right);
+
+			relocate(l, l->_count, parent, i);
+
+			for (std::size_t j = 0; j < r->_count; ++j) {
+				relocate(l, l->_count + 1 + j, r, j);
+			}
+
+			for (std::size_t j = 0; j <= r->_count; ++j) {
+				l->_children[l->_count + 1 + j] = r->_children[j];
+			}
+
+			l->_count = static_cast<unsigned short>(l->_count + 1 + r->_count);
+			r->_count = 0;
+		}
+
+		destroy_node(right);
+
+		// Separator i is gone (destroyed or moved down), along with child i + 1
+		shift(parent, i + 1, -1);
+		shift_children(parent, i + 2, -1);
+		parent->_count--;
+	}
+}
+
+
+#endif
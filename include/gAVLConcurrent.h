@@ -0,0 +1,444 @@
+#ifndef GAVLCONCURRENT_H_
+#define GAVLCONCURRENT_H_
+
+#include <gAVL.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bst {
+	// Child or root link of a gAVLConcurrent -- loads acquire and stores release, so a lookup following a link the writer just
+	// changed sees the node it leads to fully built, and sees it marked as being changed (see gAVLSharedLinks) before its new links
+	template <typename Node>
+	class gAVLSharedLink {
+		public:
+			gAVLSharedLink(Node* node = nullptr) : _node(node) {}
+			gAVLSharedLink(const gAVLSharedLink& other) : _node(static_cast<Node*>(other)) {}
+
+			gAVLSharedLink& operator=(const gAVLSharedLink& other) { return *this = static_cast<Node*>(other); }
+			gAVLSharedLink& operator=(Node* node) { _node.store(node, std::memory_order_release); return *this; }
+			operator Node*() const { return _node.load(std::memory_order_acquire); }
+			Node* operator->() const { return *this; }
+
+		protected:
+			std::atomic<Node*> _node;
+	};
+
+	// Augmentation of the tree inside gAVLConcurrent: Augment itself, plus the number of the last write that changed the node's
+	// links. A write numbers itself before it changes anything, and the tree records which one is running, so a node whose
+	// number is that of the running write is in the middle of being changed
+	template <typename Augment>
+	struct gAVLSharedLinks {
+		static const bool enabled = Augment::enabled;
+
+		struct node_data : public Augment::node_data {
+			node_data() : _changed(0) {}
+
+			std::atomic<std::size_t> _changed;	// 0 until some write changes the links
+		};
+
+		template <typename Node>
+		static void update(Node* node) {
+			Augment::update(node);
+		}
+
+		// Number of the write the calling thread is running (writers hold the tree's lock, so a thread only ever runs one)
+		static std::size_t& write() {
+			static thread_local std::size_t number = 0;
+
+			return number;
+		}
+	};
+
+	template <typename Node, typename Augment>
+	struct gAVLLinks<Node, gAVLSharedLinks<Augment>> {
+		typedef gAVLSharedLink<Node> type;
+
+		// Release, so a lookup that sees the number also sees the write it belongs to as running
+		static void relinking(Node* node) {
+			node->_changed.store(gAVLSharedLinks<Augment>::write(), std::memory_order_release);
+		}
+	};
+
+	/*
+		gAVL shared between threads: lookups are optimistic and take no lock, writers take turns (link with -pthread)
+
+		Lookups validate node by node, hand-over-hand, in the manner of Bronson et al.'s concurrent AVL tree. Every node carries
+		the number of the last write that changed its links, and a write stamps each node before it changes that node's links.
+		A lookup notes the number of a node, waits if the write it names is still running, reads the link it wants, notes the
+		number of the child it leads to, and only then checks that the node's number is still the same, so the child was still
+		linked there and the key still belonged under it. A node's range of keys only ever shrinks by its own links changing,
+		so a lookup that sees no number change on its way down raced nothing, and one that does starts over. A write thus only
+		holds up the lookups passing through the few nodes it relinks, not those elsewhere in the tree. The links are atomic
+		(see gAVLSharedLink), so nothing a lookup reads races the writer. Removed nodes are only freed once every lookup that
+		could still be looking at them is done (epoch based reclamation).
+	*/
+	template <typename T, typename Compare = gAVLCompare<T>, typename Allocator = std::allocator<T>, typename Augment = gAVLNoAugment>
+	class gAVLConcurrent : protected gAVL<T, Compare, Allocator, gAVLSharedLinks<Augment>> {
+		public:
+			explicit gAVLConcurrent(const Compare& comparator = Compare(), const Allocator& allocator = Allocator());
+			~gAVLConcurrent();
+
+			gAVLConcurrent(const gAVLConcurrent&) = delete;
+			gAVLConcurrent& operator=(const gAVLConcurrent&) = delete;
+
+			// Writers run one at a time, alongside any number of lookups
+			bool insert(const T& data);				// [O(log(n))]
+			bool insert(T&& data);					// [O(log(n))]
+			template <typename... Args> bool emplace(Args&&... args);	// [O(log(n))]
+			bool remove(const T& data);				// [O(log(n))]
+			void clear();							// Nodes are freed later on, once no lookup can be using them anymore [O(n)]
+
+			// Lookups, safe to call from any number of threads at once
+			std::size_t size() const;				// [O(1)]
+			bool contains(const T& data) const;		// [O(log(n))] plus the writes it has to wait out on its path
+			bool search(const T& search_data, T& found_data) const;
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> bool contains(const K& key) const;
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> bool search(const K& search_key, T& found_data) const;
+
+		protected:
+			typedef gAVLSharedLinks<Augment> shared_augment;
+			typedef gAVL<T, Compare, Allocator, shared_augment> tree_type;
+			typedef gAVLNode<T, shared_augment> node_type;
+
+			static const int max_steps = 128;		// Higher than any AVL tree that fits in memory, a descent taking longer started over too seldom to matter
+			static const int spins = 64;			// Times a lookup checks on a node being changed, or starts over, before yielding
+			static const std::size_t reader_slots = 64;
+
+			// Readers in each of the last 3 epochs, padded out to a cache line each so lookups on different threads don't contend
+			struct Slot {
+				std::atomic<std::size_t> _readers[3];
+				char _padding[64 - 3 * sizeof(std::atomic<std::size_t>)];
+
+				Slot() {
+					for (std::atomic<std::size_t>& readers : _readers) {
+						readers.store(0, std::memory_order_relaxed);
+					}
+				}
+			};
+
+			// Keeps every node reachable when it is constructed from being freed until it is destroyed
+			class ReadGuard {
+				public:
+					explicit ReadGuard(const gAVLConcurrent& tree);
+					~ReadGuard();
+
+				protected:
+					Slot& _slot;
+					std::size_t _epoch;
+			};
+
+			// Holds the writer lock, lookups go on undisturbed until begin() is called right before the tree is modified
+			class WriteGuard {
+				public:
+					explicit WriteGuard(gAVLConcurrent& tree);
+					~WriteGuard();
+
+					void begin();
+
+				protected:
+					gAVLConcurrent& _tree;
+					std::lock_guard<std::mutex> _lock;
+					bool _begun;
+			};
+
+			static std::size_t slot_index();
+			template <typename K> bool search_node(const K& key, T* found_data) const;
+			template <typename K> bool lookup(const K& key, const node_type*& found) const;	// Returns false if it has to start over
+			std::size_t settled(const node_type* node) const;	// Number of node, once no running write is changing it
+			void retire(node_type* node);
+			void reclaim();
+
+			mutable std::mutex _writer;
+			std::size_t _writes;					// Numbers the writes, only touched under the writer lock
+			std::atomic<std::size_t> _running;		// Number of the write going on, 0 in between
+			std::atomic<std::size_t> _count;		// tree_type::_size, for lookups
+			std::atomic<std::size_t> _epoch;
+			mutable Slot _slots[reader_slots];
+			std::vector<node_type*> _retired[3];	// Removed during each of the last 3 epochs
+	};
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	gAVLConcurrent<T, Compare, Allocator, Augment>::gAVLConcurrent(const Compare& comparator, const Allocator& allocator) : tree_type(comparator, allocator), _writes(0), _running(0), _count(0), _epoch(0) {
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	gAVLConcurrent<T, Compare, Allocator, Augment>::~gAVLConcurrent() {
+		// No lookups can be left by now
+		for (std::vector<node_type*>& retired : _retired) {
+			for (node_type* node : retired) {
+				this->destroy_node(node);
+			}
+		}
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	bool gAVLConcurrent<T, Compare, Allocator, Augment>::insert(const T& data) {
+		return emplace(data);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	bool gAVLConcurrent<T, Compare, Allocator, Augment>::insert(T&& data) {
+		return emplace(std::move(data));
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	template <typename... Args>
+	bool gAVLConcurrent<T, Compare, Allocator, Augment>::emplace(Args&&... args) {
+		WriteGuard guard(*this);
+
+		// The value is built and its place found before guard.begin() numbers the write, so the only nodes that can hold up or
+		// restart a lookup are the ones link_node and the retrace after it stamp
+		node_type* node = this->create_node(std::forward<Args>(args)...);
+		int comp = 0;
+		node_type* p = this->find_slot(node->_data, comp);
+
+		if (p != nullptr && comp == 0) {
+			this->destroy_node(node);
+			return false;
+		}
+
+		guard.begin();
+		this->link_node(p, comp, node);
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	bool gAVLConcurrent<T, Compare, Allocator, Augment>::remove(const T& data) {
+		WriteGuard guard(*this);
+
+		node_type* q = this->find(data);
+
+		if (q == nullptr) {
+			return false;
+		}
+
+		guard.begin();
+
+		if (this->unlink_node(q)) {
+			this->_height--;
+		}
+
+		this->_size--;
+
+		retire(q);
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	void gAVLConcurrent<T, Compare, Allocator, Augment>::clear() {
+		WriteGuard guard(*this);
+
+		guard.begin();
+
+		// Every lookup still in the old tree has to start over and find it gone
+		auto detach = [this](node_type* node) {
+			tree_type::link_traits::relinking(node);
+			retire(node);
+		};
+
+		tree_type::walk(static_cast<node_type*>(this->_root), detach);
+
+		this->_root = nullptr;
+		this->_size = 0;
+		this->_height = 0;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	std::size_t gAVLConcurrent<T, Compare, Allocator, Augment>::size() const {
+		return _count.load(std::memory_order_acquire);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	bool gAVLConcurrent<T, Compare, Allocator, Augment>::contains(const T& data) const {
+		return search_node(data, nullptr);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	bool gAVLConcurrent<T, Compare, Allocator, Augment>::search(const T& search_data, T& found_data) const {
+		return search_node(search_data, &found_data);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	template <typename K, typename C, typename>
+	bool gAVLConcurrent<T, Compare, Allocator, Augment>::contains(const K& key) const {
+		return search_node(key, nullptr);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	template <typename K, typename C, typename>
+	bool gAVLConcurrent<T, Compare, Allocator, Augment>::search(const K& search_key, T& found_data) const {
+		return search_node(search_key, &found_data);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	template <typename K>
+	bool gAVLConcurrent<T, Compare, Allocator, Augment>::search_node(const K& key, T* found_data) const {
+		ReadGuard guard(*this);
+
+		const node_type* found = nullptr;
+
+		for (int attempt = 1; !lookup(key, found); ++attempt) {
+			if (attempt % spins == 0) {
+				std::this_thread::yield();
+			}
+		}
+
+		// Whatever happened to it since, the node can't be freed before the guard goes
+		if (found != nullptr && found_data != nullptr) {
+			*found_data = found->_data;
+		}
+
+		return found != nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	template <typename K>
+	bool gAVLConcurrent<T, Compare, Allocator, Augment>::lookup(const K& key, const node_type*& found) const {
+		found = nullptr;
+
+		const node_type* p = this->_root;
+
+		if (p == nullptr) {
+			return true;
+		}
+
+		// Still the root once settled, so the whole tree is below it
+		std::size_t changed = settled(p);
+
+		if (this->_root != p) {
+			return false;
+		}
+
+		for (int steps = 0; steps < max_steps; ++steps) {
+			int comp = this->_comparator(key, p->_data);
+
+			if (comp == 0) {
+				// p was still linked when the key was compared, unless it was changed (removal included) since
+				found = p;
+
+				return p->_changed.load(std::memory_order_acquire) == changed;
+			}
+
+			const node_type* c = (comp < 0) ? p->_left : p->_right;
+
+			if (c == nullptr) {
+				return p->_changed.load(std::memory_order_acquire) == changed;
+			}
+
+			std::size_t next = settled(c);
+
+			// Unchanged p means c was its child all along, and the key still belongs under c
+			if (p->_changed.load(std::memory_order_acquire) != changed) {
+				return false;
+			}
+
+			p = c;
+			changed = next;
+		}
+
+		return false;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	std::size_t gAVLConcurrent<T, Compare, Allocator, Augment>::settled(const node_type* node) const {
+		for (int spin = 1; ; ++spin) {
+			std::size_t changed = node->_changed.load(std::memory_order_acquire);
+
+			if (changed == 0 || changed != _running.load(std::memory_order_acquire)) {
+				return changed;
+			}
+
+			// Writes only relink a handful of nodes, this is soon over
+			if (spin % spins == 0) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	void gAVLConcurrent<T, Compare, Allocator, Augment>::retire(node_type* node) {
+		_retired[_epoch.load(std::memory_order_relaxed) % 3].push_back(node);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	void gAVLConcurrent<T, Compare, Allocator, Augment>::reclaim() {
+		// Called by the writer on its way out: nodes removed during epoch e - 1 are safe to free once no lookup that began in
+		// epoch e - 1 (or before, those were waited out to get to e) is left, at which point the epoch moves on to e + 1
+		std::size_t e = _epoch.load(std::memory_order_relaxed);
+		std::size_t previous = (e + 2) % 3;
+
+		for (const Slot& slot : _slots) {
+			if (slot._readers[previous].load() != 0) {
+				return;
+			}
+		}
+
+		for (node_type* node : _retired[previous]) {
+			this->destroy_node(node);
+		}
+
+		_retired[previous].clear();
+		_epoch.store(e + 1);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	std::size_t gAVLConcurrent<T, Compare, Allocator, Augment>::slot_index() {
+		static std::atomic<std::size_t> next(0);
+		static thread_local std::size_t index = next++ % reader_slots;
+
+		return index;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	gAVLConcurrent<T, Compare, Allocator, Augment>::ReadGuard::ReadGuard(const gAVLConcurrent& tree) : _slot(tree._slots[slot_index()]), _epoch(0) {
+		// If the epoch moved on in the meantime, the writer may already have checked the count this reader went into
+		while (true) {
+			_epoch = tree._epoch.load();
+			_slot._readers[_epoch % 3]++;
+
+			if (tree._epoch.load() == _epoch) {
+				break;
+			}
+
+			_slot._readers[_epoch % 3]--;
+		}
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	gAVLConcurrent<T, Compare, Allocator, Augment>::ReadGuard::~ReadGuard() {
+		_slot._readers[_epoch % 3]--;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	gAVLConcurrent<T, Compare, Allocator, Augment>::WriteGuard::WriteGuard(gAVLConcurrent& tree) : _tree(tree), _lock(tree._writer), _begun(false) {
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	gAVLConcurrent<T, Compare, Allocator, Augment>::WriteGuard::~WriteGuard() {
+		if (_begun) {
+			_tree._count.store(_tree._size, std::memory_order_release);
+			_tree._running.store(0, std::memory_order_release);
+			shared_augment::write() = 0;
+		}
+
+		_tree.reclaim();
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	void gAVLConcurrent<T, Compare, Allocator, Augment>::WriteGuard::begin() {
+		// Every node stamped from here on is taken as in the middle of being changed, until the destructor
+		std::size_t write = ++_tree._writes;
+
+		_tree._running.store(write, std::memory_order_release);
+		shared_augment::write() = write;
+		_begun = true;
+	}
+}
+
+
+#endif
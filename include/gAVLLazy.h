@@ -0,0 +1,419 @@
+#ifndef GAVLLAZY_H_
+#define GAVLLAZY_H_
+
+#include <gAVL.h>
+
+#include <limits>
+#include <vector>
+
+namespace bst {
+	// Augmentation gAVLLazy runs on -- which nodes are tombstones, and how many live values each subtree holds
+	struct gAVLTombstoneAugment {
+		static const bool enabled = true;
+
+		struct node_data {
+			node_data() : _dead(0), _live(1) {}
+
+			// Packed into one word, which keeps the node as small as a gAVLCountAugment one
+			std::size_t _dead : 1;	// Removed, but still linked in
+			std::size_t _live : std::numeric_limits<std::size_t>::digits - 1;	// Number of nodes in the subtree rooted here that aren't tombstones
+		};
+
+		template <typename Node>
+		static void update(Node* node) {
+			node->_live = (node->_dead ? 0 : 1) + ((node->_left != nullptr) ? node->_left->_live : 0) + ((node->_right != nullptr) ? node->_right->_live : 0);
+		}
+	};
+
+	/*
+		gAVL with lazy deletion: remove() leaves the node where it is as a tombstone and only updates the live counts on its
+		path, instead of unlinking it and retracing (and possibly rotating) all the way up to the root
+
+		Lookups, bounds and iteration only ever see live values, the live counts let them step over subtrees holding nothing
+		but tombstones in O(log(n)). compact() frees every tombstone and rebuilds the tree from the live values in one linear
+		pass -- remove() calls it on its own once tombstones make up more than the compaction threshold of the nodes, which
+		bounds the memory and the lookup cost they add to a constant factor. Inserting a value equal to a tombstone brings
+		the node back to life, assigning the new value to it.
+	*/
+	template <typename T, typename Compare = gAVLCompare<T>, typename Allocator = std::allocator<T>>
+	class gAVLLazy : protected gAVL<T, Compare, Allocator, gAVLTombstoneAugment> {
+		protected:
+			typedef gAVL<T, Compare, Allocator, gAVLTombstoneAugment> tree_type;
+			typedef gAVLNode<T, gAVLTombstoneAugment> Node;
+
+		public:
+			typedef Compare comparator_type;
+			typedef Allocator allocator_type;
+
+			// Read-only, bidirectional, in-order position of a live value, stays valid until the tree is compacted
+			class const_iterator {
+				public:
+					typedef std::bidirectional_iterator_tag iterator_category;
+					typedef T value_type;
+					typedef std::ptrdiff_t difference_type;
+					typedef const T& reference;
+					typedef const T* pointer;
+
+					const_iterator() : _node(nullptr), _tree(nullptr) {}
+
+					reference operator*() const { return _node->_data; }
+					pointer operator->() const { return &_node->_data; }
+
+					const_iterator& operator++() {
+						_node = next_live(_node);
+						return *this;
+					}
+
+					const_iterator operator++(int) {
+						const_iterator it = *this;
+						++(*this);
+						return it;
+					}
+
+					const_iterator& operator--() {
+						// Stepping back from end() lands on the "most" live value
+						_node = (_node == nullptr) ? last_live(_tree->_root) : prev_live(_node);
+						return *this;
+					}
+
+					const_iterator operator--(int) {
+						const_iterator it = *this;
+						--(*this);
+						return it;
+					}
+
+					bool operator==(const const_iterator& other) const { return _node == other._node; }
+					bool operator!=(const const_iterator& other) const { return _node != other._node; }
+
+				protected:
+					friend class gAVLLazy;
+
+					const_iterator(const Node* node, const gAVLLazy* tree) : _node(node), _tree(tree) {}
+
+					const Node* _node;	// nullptr is end()
+					const gAVLLazy* _tree;
+			};
+
+			typedef const_iterator iterator;
+
+			explicit gAVLLazy(const Compare& comparator = Compare(), const Allocator& allocator = Allocator());
+
+			bool insert(const T& data);				// Adds data unless an equal live value exists (an equal tombstone is revived, data assigned to it) [O(log(n))]
+			bool insert(T&& data);					// [O(log(n))]
+			bool remove(const T& data);				// Turns the live value equal to data into a tombstone (if there is none does nothing) [O(log(n)), O(n) if it triggers compact()]
+			void compact();							// Frees every tombstone and rebuilds the tree, perfectly balanced, out of the live values [O(n)]
+			void set_compaction_threshold(double dead_fraction);	// remove() compacts once more than dead_fraction of the nodes are tombstones (0.5 by default, 1 or more only compacts on request) [O(1)]
+
+			bool contains(const T& data) const;		// [O(log(n))]
+			bool search(const T& search_data, T& found_data) const;	// [O(log(n))]
+			const_iterator find(const T& data) const;	// Position of the live value equal to data, or end() [O(log(n))]
+			const_iterator lower_bound(const T& data) const;	// Position of the first live value not before data, or end() [O(log(n))]
+			const_iterator upper_bound(const T& data) const;	// Position of the first live value after data, or end() [O(log(n))]
+			const_iterator begin() const;			// [O(log(n))]
+			const_iterator end() const;				// [O(1)]
+			const_iterator cbegin() const;
+			const_iterator cend() const;
+
+			std::size_t size() const;				// Number of live values [O(1)]
+			std::size_t tombstones() const;			// Number of removed values still taking up a node [O(1)]
+			using tree_type::height;				// [O(1)], tombstones included
+			using tree_type::height_bounds;
+			using tree_type::clear;					// Removes every value and tombstone [O(n)]
+			using tree_type::get_allocator;
+
+		protected:
+			template <typename V> bool insert_value(V&& data);
+			const Node* find_live(const T& data) const;
+			const Node* live_bound(const T& data, bool inclusive) const;	// First live node not before (inclusive) or after data
+			static std::size_t live(const Node* node);
+			static void adjust_live(Node* node, int delta);	// node went from live to tombstone or back, only the counts on its path change
+			template <typename N> static N* first_live(N* node);
+			template <typename N> static N* last_live(N* node);
+			template <typename N> static N* next_live(N* node);
+			template <typename N> static N* prev_live(N* node);
+
+			double _compaction_threshold;
+	};
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLLazy<T, Compare, Allocator>::gAVLLazy(const Compare& comparator, const Allocator& allocator) : tree_type(comparator, allocator), _compaction_threshold(0.5) {
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	bool gAVLLazy<T, Compare, Allocator>::insert(const T& data) {
+		return insert_value(data);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	bool gAVLLazy<T, Compare, Allocator>::insert(T&& data) {
+		return insert_value(std::move(data));
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	template <typename V>
+	bool gAVLLazy<T, Compare, Allocator>::insert_value(V&& data) {
+		int comp = 0;
+		Node* p = this->find_slot(data, comp);
+
+		if (p != nullptr && comp == 0) {
+			if (!p->_dead) {
+				return false;
+			}
+
+			p->_data = std::forward<V>(data);
+			p->_dead = 0;
+			adjust_live(p, 1);
+
+			return true;
+		}
+
+		Node* node = this->create_node(std::forward<V>(data));
+		this->link_node(p, comp, node);
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	bool gAVLLazy<T, Compare, Allocator>::remove(const T& data) {
+		Node* q = tree_type::find(data);
+
+		if (q == nullptr || q->_dead) {
+			return false;
+		}
+
+		q->_dead = 1;
+		adjust_live(q, -1);
+
+		if (static_cast<double>(tombstones()) > _compaction_threshold * static_cast<double>(this->_size)) {
+			compact();
+		}
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	void gAVLLazy<T, Compare, Allocator>::compact() {
+		if (tombstones() == 0) {
+			return;
+		}
+
+		std::vector<Node*> nodes;
+		auto gather = [&nodes](Node* node) { nodes.push_back(node); };
+
+		nodes.reserve(this->_size);
+		tree_type::walk(this->_root, gather);
+
+		// Every node is off the list before any is freed, the live ones stay in order for the bottom-up build
+		std::size_t kept = 0;
+
+		for (Node* node : nodes) {
+			if (node->_dead) {
+				this->destroy_node(node);
+			} else {
+				nodes[kept++] = node;
+			}
+		}
+
+		this->_root = this->build(nodes.data(), kept, nullptr);
+		this->_size = kept;
+		this->_height = tree_type::build_height(kept);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	void gAVLLazy<T, Compare, Allocator>::set_compaction_threshold(double dead_fraction) {
+		_compaction_threshold = dead_fraction;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	bool gAVLLazy<T, Compare, Allocator>::contains(const T& data) const {
+		return find_live(data) != nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	bool gAVLLazy<T, Compare, Allocator>::search(const T& search_data, T& found_data) const {
+		const Node* q = find_live(search_data);
+
+		if (q == nullptr) {
+			return false;
+		}
+
+		found_data = q->_data;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	typename gAVLLazy<T, Compare, Allocator>::const_iterator gAVLLazy<T, Compare, Allocator>::find(const T& data) const {
+		return const_iterator(find_live(data), this);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	typename gAVLLazy<T, Compare, Allocator>::const_iterator gAVLLazy<T, Compare, Allocator>::lower_bound(const T& data) const {
+		return const_iterator(live_bound(data, true), this);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	typename gAVLLazy<T, Compare, Allocator>::const_iterator gAVLLazy<T, Compare, Allocator>::upper_bound(const T& data) const {
+		return const_iterator(live_bound(data, false), this);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	typename gAVLLazy<T, Compare, Allocator>::const_iterator gAVLLazy<T, Compare, Allocator>::begin() const {
+		return const_iterator(first_live(static_cast<const Node*>(this->_root)), this);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	typename gAVLLazy<T, Compare, Allocator>::const_iterator gAVLLazy<T, Compare, Allocator>::end() const {
+		return const_iterator(nullptr, this);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	typename gAVLLazy<T, Compare, Allocator>::const_iterator gAVLLazy<T, Compare, Allocator>::cbegin() const {
+		return begin();
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	typename gAVLLazy<T, Compare, Allocator>::const_iterator gAVLLazy<T, Compare, Allocator>::cend() const {
+		return end();
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	std::size_t gAVLLazy<T, Compare, Allocator>::size() const {
+		return live(this->_root);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	std::size_t gAVLLazy<T, Compare, Allocator>::tombstones() const {
+		return this->_size - live(this->_root);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	const typename gAVLLazy<T, Compare, Allocator>::Node* gAVLLazy<T, Compare, Allocator>::find_live(const T& data) const {
+		int comp = 0;
+		const Node* p = this->find_slot(data, comp);
+
+		return (p != nullptr && comp == 0 && !p->_dead) ? p : nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	const typename gAVLLazy<T, Compare, Allocator>::Node* gAVLLazy<T, Compare, Allocator>::live_bound(const T& data, bool inclusive) const {
+		// Every node the descent turns left at comes with its right subtree, all of them past data, and before whatever such a
+		// node further up brought along: the answer is the first live node of the lowest of these that holds any
+		const Node* q = this->_root;
+		const Node* region = nullptr;
+
+		while (q != nullptr) {
+			int comp = this->_comparator(data, q->_data);
+
+			if (comp < 0 || (comp == 0 && inclusive)) {
+				if (!q->_dead || live(q->_right) > 0) {
+					region = q;
+				}
+
+				q = q->_left;
+			} else {
+				q = q->_right;
+			}
+		}
+
+		if (region == nullptr) {
+			return nullptr;
+		}
+
+		return region->_dead ? first_live(static_cast<const Node*>(region->_right)) : region;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	std::size_t gAVLLazy<T, Compare, Allocator>::live(const Node* node) {
+		return (node != nullptr) ? node->_live : 0;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	void gAVLLazy<T, Compare, Allocator>::adjust_live(Node* node, int delta) {
+		// Stepping each count on the path by one reads nothing but the path, unlike recomputing them from both children
+		for (; node != nullptr; node = node->_parent) {
+			node->_live += delta;
+		}
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	template <typename N>
+	N* gAVLLazy<T, Compare, Allocator>::first_live(N* node) {
+		// Subtrees of nothing but tombstones are stepped over, not into
+		while (node != nullptr) {
+			if (live(node->_left) > 0) {
+				node = node->_left;
+			} else if (!node->_dead) {
+				return node;
+			} else {
+				node = node->_right;
+			}
+		}
+
+		return nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	template <typename N>
+	N* gAVLLazy<T, Compare, Allocator>::last_live(N* node) {
+		while (node != nullptr) {
+			if (live(node->_right) > 0) {
+				node = node->_right;
+			} else if (!node->_dead) {
+				return node;
+			} else {
+				node = node->_left;
+			}
+		}
+
+		return nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	template <typename N>
+	N* gAVLLazy<T, Compare, Allocator>::next_live(N* node) {
+		if (live(node->_right) > 0) {
+			return first_live(static_cast<N*>(node->_right));
+		}
+
+		// Up to the first ancestor node is left of that is live itself or has live values on its right
+		for (N* p = node->_parent; p != nullptr; node = p, p = p->_parent) {
+			if (p->_left == node) {
+				if (!p->_dead) {
+					return p;
+				}
+
+				if (live(p->_right) > 0) {
+					return first_live(static_cast<N*>(p->_right));
+				}
+			}
+		}
+
+		return nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	template <typename N>
+	N* gAVLLazy<T, Compare, Allocator>::prev_live(N* node) {
+		if (live(node->_left) > 0) {
+			return last_live(static_cast<N*>(node->_left));
+		}
+
+		for (N* p = node->_parent; p != nullptr; node = p, p = p->_parent) {
+			if (p->_right == node) {
+				if (!p->_dead) {
+					return p;
+				}
+
+				if (live(p->_left) > 0) {
+					return last_live(static_cast<N*>(p->_left));
+				}
+			}
+		}
+
+		return nullptr;
+	}
+}
+
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef GAVLMAP_H_
+#define GAVLMAP_H_
+
+#include <gAVL.h>
+
+#include <tuple>
+#include <utility>
+
+namespace bst {
+	// Orders the entries of a gAVLMap by their keys alone, lookups hand it the bare key
+	template <typename K, typename V, typename Compare>
+	struct gAVLKeyCompare {
+		typedef void is_transparent;
+
+		explicit gAVLKeyCompare(const Compare& comparator = Compare()) : _comparator(comparator) {}
+
+		int operator()(const std::pair<const K, V>& a, const std::pair<const K, V>& b) const {
+			return _comparator(a.first, b.first);
+		}
+
+		int operator()(const K& key, const std::pair<const K, V>& b) const {
+			return _comparator(key, b.first);
+		}
+
+		Compare _comparator;
+	};
+
+	/*
+		Ordered key/value map on top of the gAVL core
+
+		Entries are std::pair<const K, V> ordered by Compare on the key only, so a lookup never builds (or copies) a value,
+		and the value of an existing entry is changed in place through the iterator, operator[] or insert_or_assign, without
+		taking the entry out and putting it back (and rebalancing twice). Inserting and removing entries goes through the
+		same retrace/rotate code as gAVL itself.
+	*/
+	template <typename K, typename V, typename Compare = gAVLCompare<K>, typename Allocator = std::allocator<std::pair<const K, V>>, typename Augment = gAVLNoAugment>
+	class gAVLMap : protected gAVL<std::pair<const K, V>, gAVLKeyCompare<K, V, Compare>, Allocator, Augment> {
+		public:
+			typedef K key_type;
+			typedef V mapped_type;
+			typedef std::pair<const K, V> value_type;
+			typedef Compare key_compare;
+			typedef Allocator allocator_type;
+
+		protected:
+			typedef gAVL<value_type, gAVLKeyCompare<K, V, Compare>, Allocator, Augment> tree_type;
+			typedef gAVLNode<value_type, Augment> Node;
+
+		public:
+			// Bidirectional, in-order position of an entry, Value is value_type or const value_type
+			// The key can't be modified through it (that could break the ordering), the value can unless it is a const_iterator
+			// Stays valid until the entry it points at is removed
+			template <typename Value>
+			class basic_iterator {
+				public:
+					typedef std::bidirectional_iterator_tag iterator_category;
+					typedef std::pair<const K, V> value_type;
+					typedef std::ptrdiff_t difference_type;
+					typedef Value& reference;
+					typedef Value* pointer;
+
+					basic_iterator() : _node(nullptr), _map(nullptr) {}
+					basic_iterator(const basic_iterator<value_type>& other) : _node(other._node), _map(other._map) {}	// iterator to const_iterator
+
+					reference operator*() const { return _node->_data; }
+					pointer operator->() const { return &_node->_data; }
+
+					basic_iterator& operator++() {
+						_node = tree_type::successor(_node);
+						return *this;
+					}
+
+					basic_iterator operator++(int) {
+						basic_iterator it = *this;
+						++(*this);
+						return it;
+					}
+
+					basic_iterator& operator--() {
+						// Stepping back from end() lands on the entry with the "most" key
+						_node = (_node == nullptr) ? tree_type::rightmost(_map->_root) : tree_type::predecessor(_node);
+						return *this;
+					}
+
+					basic_iterator operator--(int) {
+						basic_iterator it = *this;
+						--(*this);
+						return it;
+					}
+
+					friend bool operator==(const basic_iterator& a, const basic_iterator& b) { return a._node == b._node; }
+					friend bool operator!=(const basic_iterator& a, const basic_iterator& b) { return a._node != b._node; }
+
+				protected:
+					friend class gAVLMap;
+					template <typename U> friend class basic_iterator;
+
+					basic_iterator(Node* node, const gAVLMap* map) : _node(node), _map(map) {}
+
+					Node* _node;	// nullptr is end()
+					const gAVLMap* _map;
+			};
+
+			typedef basic_iterator<value_type> iterator;
+			typedef basic_iterator<const value_type> const_iterator;
+
+			explicit gAVLMap(const Compare& comparator = Compare(), const Allocator& allocator = Allocator());
+
+			V& operator[](const K& key);				// Value of key, inserting a value initialized one first if key isn't in the map yet [O(log(n))]
+			V& operator[](K&& key);
+			template <typename... Args> std::pair<iterator, bool> try_emplace(const K& key, Args&&... args);	// Adds key with a value built from args and returns its position and true, or the position of the entry already holding key and false -- args are left untouched then [O(log(n))]
+			template <typename... Args> std::pair<iterator, bool> try_emplace(K&& key, Args&&... args);
+			template <typename M> std::pair<iterator, bool> insert_or_assign(const K& key, M&& value);	// Same as try_emplace, assigning value to the entry already holding key (in place) instead of leaving it be [O(log(n))]
+			template <typename M> std::pair<iterator, bool> insert_or_assign(K&& key, M&& value);
+			std::pair<iterator, bool> insert(const value_type& entry);	// Same as try_emplace(entry.first, entry.second) [O(log(n))]
+			bool remove(const K& key);					// Removes the entry holding key (if there is none does nothing) [O(log(n))]
+			iterator erase(const_iterator position);	// Removes the entry at position, returns the position of the one after it [O(log(n))]
+
+			iterator find(const K& key);				// Position of the entry holding key, or end() [O(log(n))]
+			const_iterator find(const K& key) const;
+			bool contains(const K& key) const;			// [O(log(n))]
+			iterator lower_bound(const K& key);			// Position of the first entry whose key is not before key, or end() [O(log(n))]
+			const_iterator lower_bound(const K& key) const;
+			iterator upper_bound(const K& key);			// Position of the first entry whose key is after key, or end() [O(log(n))]
+			const_iterator upper_bound(const K& key) const;
+
+			iterator begin();							// Position of the entry with the comparator "least" key [O(log(n))]
+			iterator end();								// [O(1)]
+			const_iterator begin() const;
+			const_iterator end() const;
+			const_iterator cbegin() const;
+			const_iterator cend() const;
+
+			std::size_t size() const;					// Returns the number of entries in the map [O(1)]
+			bool empty() const;							// [O(1)]
+			using tree_type::height;					// [O(1)]
+			using tree_type::height_bounds;
+			using tree_type::clear;						// Removes every entry [O(n)]
+			using tree_type::get_allocator;
+
+		protected:
+			template <typename Key, typename... Args> std::pair<iterator, bool> emplace_key(Key&& key, Args&&... args);
+	};
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	gAVLMap<K, V, Compare, Allocator, Augment>::gAVLMap(const Compare& comparator, const Allocator& allocator) : tree_type(gAVLKeyCompare<K, V, Compare>(comparator), allocator) {
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	V& gAVLMap<K, V, Compare, Allocator, Augment>::operator[](const K& key) {
+		return emplace_key(key).first->second;
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	V& gAVLMap<K, V, Compare, Allocator, Augment>::operator[](K&& key) {
+		return emplace_key(std::move(key)).first->second;
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	template <typename... Args>
+	std::pair<typename gAVLMap<K, V, Compare, Allocator, Augment>::iterator, bool> gAVLMap<K, V, Compare, Allocator, Augment>::try_emplace(const K& key, Args&&... args) {
+		return emplace_key(key, std::forward<Args>(args)...);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	template <typename... Args>
+	std::pair<typename gAVLMap<K, V, Compare, Allocator, Augment>::iterator, bool> gAVLMap<K, V, Compare, Allocator, Augment>::try_emplace(K&& key, Args&&... args) {
+		return emplace_key(std::move(key), std::forward<Args>(args)...);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	template <typename M>
+	std::pair<typename gAVLMap<K, V, Compare, Allocator, Augment>::iterator, bool> gAVLMap<K, V, Compare, Allocator, Augment>::insert_or_assign(const K& key, M&& value) {
+		std::pair<iterator, bool> result = emplace_key(key, std::forward<M>(value));
+
+		// value was only used up if the entry is new
+		if (!result.second) {
+			result.first->second = std::forward<M>(value);
+		}
+
+		return result;
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	template <typename M>
+	std::pair<typename gAVLMap<K, V, Compare, Allocator, Augment>::iterator, bool> gAVLMap<K, V, Compare, Allocator, Augment>::insert_or_assign(K&& key, M&& value) {
+		std::pair<iterator, bool> result = emplace_key(std::move(key), std::forward<M>(value));
+
+		if (!result.second) {
+			result.first->second = std::forward<M>(value);
+		}
+
+		return result;
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	std::pair<typename gAVLMap<K, V, Compare, Allocator, Augment>::iterator, bool> gAVLMap<K, V, Compare, Allocator, Augment>::insert(const value_type& entry) {
+		return emplace_key(entry.first, entry.second);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	template <typename Key, typename... Args>
+	std::pair<typename gAVLMap<K, V, Compare, Allocator, Augment>::iterator, bool> gAVLMap<K, V, Compare, Allocator, Augment>::emplace_key(Key&& key, Args&&... args) {
+		// The slot is found through key before anything is moved out of it (or out of args) into the new entry
+		std::pair<Node*, bool> result = this->insert_unique(static_cast<const K&>(key), std::piecewise_construct, std::forward_as_tuple(std::forward<Key>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+
+		return std::pair<iterator, bool>(iterator(result.first, this), result.second);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	bool gAVLMap<K, V, Compare, Allocator, Augment>::remove(const K& key) {
+		Node* q = tree_type::find(key);
+
+		if (q == nullptr) {
+			return false;
+		}
+
+		this->erase_node(q);
+
+		return true;
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMap<K, V, Compare, Allocator, Augment>::iterator gAVLMap<K, V, Compare, Allocator, Augment>::erase(const_iterator position) {
+		// Removal relinks nodes rather than moving entries between them, so the successor stays where it is
+		Node* next = tree_type::successor(position._node);
+
+		this->erase_node(position._node);
+
+		return iterator(next, this);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMap<K, V, Compare, Allocator, Augment>::iterator gAVLMap<K, V, Compare, Allocator, Augment>::find(const K& key) {
+		return iterator(tree_type::find(key), this);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMap<K, V, Compare, Allocator, Augment>::const_iterator gAVLMap<K, V, Compare, Allocator, Augment>::find(const K& key) const {
+		int comp = 0;
+		Node* p = this->find_slot(key, comp);
+
+		return const_iterator((p != nullptr && comp == 0) ? p : nullptr, this);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	bool gAVLMap<K, V, Compare, Allocator, Augment>::contains(const K& key) const {
+		return find(key) != end();
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMap<K, V, Compare, Allocator, Augment>::iterator gAVLMap<K, V, Compare, Allocator, Augment>::lower_bound(const K& key) {
+		return iterator(this->lower_node(key), this);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMap<K, V, Compare, Allocator, Augment>::const_iterator gAVLMap<K, V, Compare, Allocator, Augment>::lower_bound(const K& key) const {
+		return const_iterator(this->lower_node(key), this);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMap<K, V, Compare, Allocator, Augment>::iterator gAVLMap<K, V, Compare, Allocator, Augment>::upper_bound(const K& key) {
+		return iterator(this->upper_node(key), this);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMap<K, V, Compare, Allocator, Augment>::const_iterator gAVLMap<K, V, Compare, Allocator, Augment>::upper_bound(const K& key) const {
+		return const_iterator(this->upper_node(key), this);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMap<K, V, Compare, Allocator, Augment>::iterator gAVLMap<K, V, Compare, Allocator, Augment>::begin() {
+		return iterator(tree_type::leftmost(this->_root), this);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMap<K, V, Compare, Allocator, Augment>::iterator gAVLMap<K, V, Compare, Allocator, Augment>::end() {
+		return iterator(nullptr, this);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMap<K, V, Compare, Allocator, Augment>::const_iterator gAVLMap<K, V, Compare, Allocator, Augment>::begin() const {
+		return const_iterator(tree_type::leftmost(this->_root), this);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMap<K, V, Compare, Allocator, Augment>::const_iterator gAVLMap<K, V, Compare, Allocator, Augment>::end() const {
+		return const_iterator(nullptr, this);
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMap<K, V, Compare, Allocator, Augment>::const_iterator gAVLMap<K, V, Compare, Allocator, Augment>::cbegin() const {
+		return begin();
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMap<K, V, Compare, Allocator, Augment>::const_iterator gAVLMap<K, V, Compare, Allocator, Augment>::cend() const {
+		return end();
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	std::size_t gAVLMap<K, V, Compare, Allocator, Augment>::size() const {
+		return this->_size;
+	}
+
+	template <typename K, typename V, typename Compare, typename Allocator, typename Augment>
+	bool gAVLMap<K, V, Compare, Allocator, Augment>::empty() const {
+		return this->_size == 0;
+	}
+}
+
+
+#endif
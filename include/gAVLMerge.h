@@ -0,0 +1,179 @@
+#ifndef GAVLMERGE_H_
+#define GAVLMERGE_H_
+
+#include <gAVL.h>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace bst {
+	/*
+		Lazy k-way merge of several trees (e.g. the shards of one index), handing out the values of all of them in comparator order -- Space O(k)
+
+		Keeps one position per tree in a binary heap ordered by the value found there, so nothing is copied out of the trees
+		and every value costs O(log(k)) comparisons on top of the step to its successor. A value held by several trees comes
+		out once for each of them, in the order the trees were given. condition filters values the same way the one taken by
+		search_after does. The trees must outlive the merge and not change while it runs through them.
+
+		Tree is anything with gAVL's const_iterator, begin/end and lower_bound/upper_bound (gAVL, gAVLMultiset, gAVLFrozen)
+	*/
+	template <typename Tree, typename Condition = gAVLAlways>
+	class gAVLMerge {
+		public:
+			typedef typename Tree::const_iterator tree_iterator;
+			typedef typename std::iterator_traits<tree_iterator>::value_type value_type;
+			typedef typename Tree::comparator_type comparator_type;
+
+			template <typename InputIt> gAVLMerge(InputIt first, InputIt last, Condition condition = Condition(), const comparator_type& comparator = comparator_type());	// Every value of the trees in [first, last) [O(k log(n))]
+			template <typename InputIt> gAVLMerge(InputIt first, InputIt last, const value_type& lo, const value_type& hi, Condition condition = Condition(), const comparator_type& comparator = comparator_type());	// Same, for the values in [lo, hi] [O(k log(n))]
+
+			// Single pass: every iterator of a merge stands at the merge's own position, so stepping one steps them all
+			class const_iterator {
+				public:
+					typedef std::input_iterator_tag iterator_category;
+					typedef typename gAVLMerge::value_type value_type;
+					typedef std::ptrdiff_t difference_type;
+					typedef const value_type* pointer;
+					typedef const value_type& reference;
+
+					const_iterator() : _merge(nullptr) {}
+
+					reference operator*() const { return _merge->front(); }
+					pointer operator->() const { return &_merge->front(); }
+
+					const_iterator& operator++() {
+						_merge->pop();
+						return *this;
+					}
+
+					bool operator==(const const_iterator& other) const { return done() == other.done(); }
+					bool operator!=(const const_iterator& other) const { return done() != other.done(); }
+
+				protected:
+					friend class gAVLMerge;
+
+					explicit const_iterator(gAVLMerge* merge) : _merge(merge) {}
+
+					bool done() const { return _merge == nullptr || _merge->empty(); }
+
+					gAVLMerge* _merge;				// nullptr is end()
+			};
+
+			typedef const_iterator iterator;
+
+			const_iterator begin();					// The next value not handed out yet [O(1)]
+			const_iterator end();					// [O(1)]
+			bool empty() const;						// True once every value went by [O(1)]
+			const value_type& front() const;		// The next value not handed out yet, the merge must not be empty() [O(1)]
+			void pop();								// Moves past front() [O(log(k)) amortized, plus every value condition rejects on the way]
+
+		protected:
+			// Where the merge stands in one of the trees
+			struct Cursor {
+				tree_iterator _at;
+				tree_iterator _end;
+				std::size_t _index;					// Which tree, breaks ties between equal values
+			};
+
+			bool after(const Cursor& a, const Cursor& b) const;	// Heap order, the cursor nothing comes before is at the front
+			void skip(Cursor& cursor);				// Moves cursor on to a value condition accepts
+			void push(const Cursor& cursor);
+
+			Condition _condition;
+			comparator_type _comparator;
+			std::vector<Cursor> _heap;
+	};
+
+	template <typename Tree, typename Condition>
+	template <typename InputIt>
+	gAVLMerge<Tree, Condition>::gAVLMerge(InputIt first, InputIt last, Condition condition, const comparator_type& comparator) : _condition(condition), _comparator(comparator) {
+		for (std::size_t i = 0; first != last; ++first, ++i) {
+			const Tree& tree = *first;
+
+			push(Cursor{tree.begin(), tree.end(), i});
+		}
+	}
+
+	template <typename Tree, typename Condition>
+	template <typename InputIt>
+	gAVLMerge<Tree, Condition>::gAVLMerge(InputIt first, InputIt last, const value_type& lo, const value_type& hi, Condition condition, const comparator_type& comparator) : _condition(condition), _comparator(comparator) {
+		if (_comparator(lo, hi) > 0) {
+			return;
+		}
+
+		for (std::size_t i = 0; first != last; ++first, ++i) {
+			const Tree& tree = *first;
+
+			push(Cursor{tree.lower_bound(lo), tree.upper_bound(hi), i});
+		}
+	}
+
+	template <typename Tree, typename Condition>
+	typename gAVLMerge<Tree, Condition>::const_iterator gAVLMerge<Tree, Condition>::begin() {
+		return const_iterator(this);
+	}
+
+	template <typename Tree, typename Condition>
+	typename gAVLMerge<Tree, Condition>::const_iterator gAVLMerge<Tree, Condition>::end() {
+		return const_iterator();
+	}
+
+	template <typename Tree, typename Condition>
+	bool gAVLMerge<Tree, Condition>::empty() const {
+		return _heap.empty();
+	}
+
+	template <typename Tree, typename Condition>
+	const typename gAVLMerge<Tree, Condition>::value_type& gAVLMerge<Tree, Condition>::front() const {
+		return *_heap.front()._at;
+	}
+
+	template <typename Tree, typename Condition>
+	void gAVLMerge<Tree, Condition>::pop() {
+		auto order = [this](const Cursor& a, const Cursor& b) -> bool { return after(a, b); };
+
+		std::pop_heap(_heap.begin(), _heap.end(), order);
+
+		Cursor cursor = _heap.back();
+
+		_heap.pop_back();
+
+		++cursor._at;
+		push(cursor);
+	}
+
+	template <typename Tree, typename Condition>
+	bool gAVLMerge<Tree, Condition>::after(const Cursor& a, const Cursor& b) const {
+		int comp = _comparator(*a._at, *b._at);
+
+		return comp > 0 || (comp == 0 && a._index > b._index);
+	}
+
+	template <typename Tree, typename Condition>
+	void gAVLMerge<Tree, Condition>::skip(Cursor& cursor) {
+		while (cursor._at != cursor._end && !_condition(*cursor._at)) {
+			++cursor._at;
+		}
+	}
+
+	template <typename Tree, typename Condition>
+	void gAVLMerge<Tree, Condition>::push(const Cursor& cursor) {
+		Cursor c = cursor;
+
+		skip(c);
+
+		// A tree that ran out drops out of the heap for good
+		if (c._at == c._end) {
+			return;
+		}
+
+		auto order = [this](const Cursor& a, const Cursor& b) -> bool { return after(a, b); };
+
+		_heap.push_back(c);
+		std::push_heap(_heap.begin(), _heap.end(), order);
+	}
+}
+
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef GAVLMULTISET_H_
+#define GAVLMULTISET_H_
+
+#include <gAVL.h>
+
+#include <type_traits>
+#include <utility>
+
+namespace bst {
+	/*
+		gAVL that keeps values the comparator finds equal instead of dropping all but the first
+
+		Every value gets a node of its own, a new one goes in after the values equal to it, so equal values form a run of
+		neighbouring nodes in insertion order (values that compare equal can still differ, e.g. events sharing a timestamp,
+		which rules out folding them into a single counted node). equal_range and count find the ends of that run with two
+		descents and step through it, and the rotations never compare anything, so the rest of the core works unchanged.
+	*/
+	template <typename T, typename Compare = gAVLCompare<T>, typename Allocator = std::allocator<T>, typename Augment = gAVLNoAugment>
+	class gAVLMultiset : protected gAVL<T, Compare, Allocator, Augment> {
+		protected:
+			typedef gAVL<T, Compare, Allocator, Augment> tree_type;
+
+		public:
+			typedef Compare comparator_type;
+			typedef Allocator allocator_type;
+			typedef typename tree_type::const_iterator const_iterator;
+			typedef const_iterator iterator;
+			typedef typename tree_type::const_reverse_iterator const_reverse_iterator;
+			typedef const_reverse_iterator reverse_iterator;
+
+			explicit gAVLMultiset(const Compare& comparator = Compare(), const Allocator& allocator = Allocator());
+			template <typename InputIt> gAVLMultiset(InputIt first, InputIt last, const Compare& comparator = Compare(), const Allocator& allocator = Allocator());	// [O(n log(n))]
+
+			const_iterator insert(const T& data);		// Adds data after every value equal to it, returns its position [O(log(n))]
+			const_iterator insert(T&& data);			// [O(log(n))]
+			template <typename... Args> const_iterator emplace(Args&&... args);	// [O(log(n))]
+			bool remove(const T& data);					// Removes the first value equal to data (if there is none does nothing) [O(log(n))]
+			std::size_t erase(const T& data);			// Removes every value equal to data, returns how many there were [O(k log(n)) for the k values removed]
+			const_iterator erase(const_iterator position);	// Removes the value at position, returns the position of the one after it [O(log(n))]
+
+			std::size_t count(const T& data) const;		// Number of values equal to data [O(log(n)) with gAVLCountAugment, O(log(n) + k) otherwise]
+			std::pair<const_iterator, const_iterator> equal_range(const T& data) const;	// Positions of the first value equal to data and of the first one after them [O(log(n))]
+			const_iterator find(const T& data) const;	// Position of the first value equal to data, or end() [O(log(n))]
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> std::size_t count(const K& key) const;
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> std::pair<const_iterator, const_iterator> equal_range(const K& key) const;
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> const_iterator find(const K& key) const;
+
+			using tree_type::lower_bound;
+			using tree_type::upper_bound;
+			using tree_type::contains;
+			using tree_type::begin;
+			using tree_type::end;
+			using tree_type::cbegin;
+			using tree_type::cend;
+			using tree_type::rbegin;
+			using tree_type::rend;
+			using tree_type::crbegin;
+			using tree_type::crend;
+			using tree_type::select;
+			using tree_type::rank;
+			using tree_type::count_range;
+			using tree_type::overlapping;
+			using tree_type::any_overlap;
+			using tree_type::for_each;
+			using tree_type::for_each_range;
+			using tree_type::to_stl_vector;
+			using tree_type::size;
+			using tree_type::height;
+			using tree_type::height_bounds;
+			using tree_type::clear;
+			using tree_type::get_allocator;
+
+		protected:
+			template <typename K> gAVLNode<T, Augment>* upper_slot(const K& key, int& comp) const;	// Node key hangs off of, past every value equal to it (left if comp < 0, right otherwise)
+			template <typename K> std::size_t count_equal(const K& key, std::true_type) const;
+			template <typename K> std::size_t count_equal(const K& key, std::false_type) const;
+	};
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	gAVLMultiset<T, Compare, Allocator, Augment>::gAVLMultiset(const Compare& comparator, const Allocator& allocator) : tree_type(comparator, allocator) {
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	template <typename InputIt>
+	gAVLMultiset<T, Compare, Allocator, Augment>::gAVLMultiset(InputIt first, InputIt last, const Compare& comparator, const Allocator& allocator) : tree_type(comparator, allocator) {
+		for (; first != last; ++first) {
+			emplace(*first);
+		}
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMultiset<T, Compare, Allocator, Augment>::const_iterator gAVLMultiset<T, Compare, Allocator, Augment>::insert(const T& data) {
+		return emplace(data);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMultiset<T, Compare, Allocator, Augment>::const_iterator gAVLMultiset<T, Compare, Allocator, Augment>::insert(T&& data) {
+		return emplace(std::move(data));
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	template <typename... Args>
+	typename gAVLMultiset<T, Compare, Allocator, Augment>::const_iterator gAVLMultiset<T, Compare, Allocator, Augment>::emplace(Args&&... args) {
+		gAVLNode<T, Augment>* node = this->create_node(std::forward<Args>(args)...);
+		int comp = 0;
+		gAVLNode<T, Augment>* p = upper_slot(node->_data, comp);
+
+		this->link_node(p, comp, node);
+
+		return this->position(node);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	bool gAVLMultiset<T, Compare, Allocator, Augment>::remove(const T& data) {
+		gAVLNode<T, Augment>* q = this->lower_node(data);
+
+		if (q == nullptr || this->_comparator(data, q->_data) != 0) {
+			return false;
+		}
+
+		this->erase_node(q);
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	std::size_t gAVLMultiset<T, Compare, Allocator, Augment>::erase(const T& data) {
+		// Removal relinks nodes rather than moving values between them, so the successor of a removed node stays put
+		gAVLNode<T, Augment>* q = this->lower_node(data);
+		std::size_t n = 0;
+
+		while (q != nullptr && this->_comparator(data, q->_data) == 0) {
+			gAVLNode<T, Augment>* next = tree_type::successor(q);
+
+			this->erase_node(q);
+			n++;
+
+			q = next;
+		}
+
+		return n;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMultiset<T, Compare, Allocator, Augment>::const_iterator gAVLMultiset<T, Compare, Allocator, Augment>::erase(const_iterator position) {
+		// position came out of this tree, so its node is ours to change
+		gAVLNode<T, Augment>* q = const_cast<gAVLNode<T, Augment>*>(tree_type::position_node(position));
+		gAVLNode<T, Augment>* next = tree_type::successor(q);
+
+		this->erase_node(q);
+
+		return this->position(next);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	std::size_t gAVLMultiset<T, Compare, Allocator, Augment>::count(const T& data) const {
+		return count_equal(data, std::integral_constant<bool, std::is_base_of<gAVLCountAugment::node_data, typename Augment::node_data>::value>());
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	template <typename K, typename C, typename>
+	std::size_t gAVLMultiset<T, Compare, Allocator, Augment>::count(const K& key) const {
+		return count_equal(key, std::integral_constant<bool, std::is_base_of<gAVLCountAugment::node_data, typename Augment::node_data>::value>());
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	std::pair<typename gAVLMultiset<T, Compare, Allocator, Augment>::const_iterator, typename gAVLMultiset<T, Compare, Allocator, Augment>::const_iterator> gAVLMultiset<T, Compare, Allocator, Augment>::equal_range(const T& data) const {
+		return std::pair<const_iterator, const_iterator>(this->position(this->lower_node(data)), this->position(this->upper_node(data)));
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	template <typename K, typename C, typename>
+	std::pair<typename gAVLMultiset<T, Compare, Allocator, Augment>::const_iterator, typename gAVLMultiset<T, Compare, Allocator, Augment>::const_iterator> gAVLMultiset<T, Compare, Allocator, Augment>::equal_range(const K& key) const {
+		return std::pair<const_iterator, const_iterator>(this->position(this->lower_node(key)), this->position(this->upper_node(key)));
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	typename gAVLMultiset<T, Compare, Allocator, Augment>::const_iterator gAVLMultiset<T, Compare, Allocator, Augment>::find(const T& data) const {
+		const gAVLNode<T, Augment>* q = this->lower_node(data);
+
+		return this->position((q != nullptr && this->_comparator(data, q->_data) == 0) ? q : nullptr);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	template <typename K, typename C, typename>
+	typename gAVLMultiset<T, Compare, Allocator, Augment>::const_iterator gAVLMultiset<T, Compare, Allocator, Augment>::find(const K& key) const {
+		const gAVLNode<T, Augment>* q = this->lower_node(key);
+
+		return this->position((q != nullptr && this->_comparator(key, q->_data) == 0) ? q : nullptr);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	template <typename K>
+	gAVLNode<T, Augment>* gAVLMultiset<T, Compare, Allocator, Augment>::upper_slot(const K& key, int& comp) const {
+		// Equal values send key right, same as values before it
+		gAVLNode<T, Augment>* p = this->_root;
+
+		while (p != nullptr) {
+			comp = (this->_comparator(key, p->_data) < 0) ? -1 : 1;
+
+			gAVLNode<T, Augment>* next = (comp < 0) ? p->_left : p->_right;
+
+			if (next == nullptr) {
+				break;
+			}
+
+			p = next;
+		}
+
+		return p;
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	template <typename K>
+	std::size_t gAVLMultiset<T, Compare, Allocator, Augment>::count_equal(const K& key, std::true_type) const {
+		return this->rank_node(key, true) - this->rank_node(key, false);
+	}
+
+	template <typename T, typename Compare, typename Allocator, typename Augment>
+	template <typename K>
+	std::size_t gAVLMultiset<T, Compare, Allocator, Augment>::count_equal(const K& key, std::false_type) const {
+		const gAVLNode<T, Augment>* q = this->lower_node(key);
+		std::size_t n = 0;
+
+		for (; q != nullptr && this->_comparator(key, q->_data) == 0; q = tree_type::successor(q)) {
+			n++;
+		}
+
+		return n;
+	}
+}
+
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef GAVLPARALLEL_H_
+#define GAVLPARALLEL_H_
+
+#include <gAVL.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bst {
+	// Work-stealing task pool for the fork-join versions of gAVL's bulk operations (link with -pthread)
+	// Any type with a fork_join(f, g) member that returns once both f() and g() have run can be passed to those instead
+	class gAVLTaskPool {
+		public:
+			explicit gAVLTaskPool(std::size_t threads = std::thread::hardware_concurrency());
+			~gAVLTaskPool();
+
+			gAVLTaskPool(const gAVLTaskPool&) = delete;
+			gAVLTaskPool& operator=(const gAVLTaskPool&) = delete;
+
+			template <typename F, typename G> void fork_join(F&& f, G&& g);	// Runs f() on the calling thread while g() may be stolen by another, rethrows whatever either of them threw
+			std::size_t concurrency() const;		// Number of threads working on tasks, the calling one included
+
+		protected:
+			struct Task {
+				std::function<void()> _run;
+				std::atomic<bool> _done;
+				std::exception_ptr _error;
+
+				Task() : _done(false) {}
+			};
+
+			struct Queue {
+				std::mutex _mutex;
+				std::deque<Task*> _tasks;
+			};
+
+			struct Home {
+				const gAVLTaskPool* _pool;
+				std::size_t _queue;
+			};
+
+			static Home& current();					// Pool the calling thread works for, if any, and its queue there
+			std::size_t home() const;				// Queue of the calling thread, the last one is shared by every thread outside of this pool
+			void push(std::size_t q, Task* task);
+			bool reclaim(std::size_t q, Task* task);	// Takes task back if nobody stole it yet
+			bool run_one(std::size_t q);			// Runs a task from queue q, or stolen from any other, returns false if there were none
+			static void run(Task* task);
+			void work(std::size_t q);
+
+			std::vector<std::unique_ptr<Queue>> _queues;
+			std::vector<std::thread> _workers;
+			std::atomic<bool> _stop;
+			std::atomic<std::size_t> _pending;
+			std::mutex _idle_mutex;
+			std::condition_variable _idle;
+	};
+
+	inline gAVLTaskPool::gAVLTaskPool(std::size_t threads) : _stop(false), _pending(0) {
+		// The calling thread takes part too, so one less is started
+		std::size_t workers = (threads > 1) ? threads - 1 : 0;
+
+		for (std::size_t i = 0; i <= workers; ++i) {
+			_queues.emplace_back(new Queue());
+		}
+
+		for (std::size_t i = 0; i < workers; ++i) {
+			_workers.emplace_back(&gAVLTaskPool::work, this, i);
+		}
+	}
+
+	inline gAVLTaskPool::~gAVLTaskPool() {
+		{
+			std::lock_guard<std::mutex> lock(_idle_mutex);
+			_stop = true;
+		}
+
+		_idle.notify_all();
+
+		for (std::thread& worker : _workers) {
+			worker.join();
+		}
+	}
+
+	template <typename F, typename G>
+	void gAVLTaskPool::fork_join(F&& f, G&& g) {
+		if (_workers.empty()) {
+			f();
+			g();
+			return;
+		}
+
+		std::size_t q = home();
+
+		Task task;
+		task._run = [&g]() { g(); };
+
+		push(q, &task);
+
+		std::exception_ptr error;
+
+		try {
+			f();
+		} catch (...) {
+			// task lives on this stack, so it has to be done with before unwinding
+			error = std::current_exception();
+		}
+
+		if (reclaim(q, &task)) {
+			run(&task);
+		} else {
+			// Stolen, help out with whatever else is queued until it is done
+			while (!task._done.load(std::memory_order_acquire)) {
+				if (!run_one(q)) {
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+
+		if (task._error) {
+			std::rethrow_exception(task._error);
+		}
+	}
+
+	inline std::size_t gAVLTaskPool::concurrency() const {
+		return _workers.size() + 1;
+	}
+
+	inline gAVLTaskPool::Home& gAVLTaskPool::current() {
+		static thread_local Home caller = { nullptr, 0 };
+
+		return caller;
+	}
+
+	inline std::size_t gAVLTaskPool::home() const {
+		// A worker of another pool is outside of this one as much as any other thread, its queue index means nothing here
+		const Home& caller = current();
+
+		if (caller._pool != this) {
+			return _queues.size() - 1;
+		}
+
+		return caller._queue;
+	}
+
+	inline void gAVLTaskPool::push(std::size_t q, Task* task) {
+		{
+			std::lock_guard<std::mutex> lock(_queues[q]->_mutex);
+			_queues[q]->_tasks.push_back(task);
+		}
+
+		{
+			// Taking the lock keeps an idle worker from missing the wake up between checking _pending and going to sleep
+			std::lock_guard<std::mutex> lock(_idle_mutex);
+			_pending++;
+		}
+
+		_idle.notify_one();
+	}
+
+	inline bool gAVLTaskPool::reclaim(std::size_t q, Task* task) {
+		std::lock_guard<std::mutex> lock(_queues[q]->_mutex);
+		std::deque<Task*>& tasks = _queues[q]->_tasks;
+
+		// Anything pushed after task was already taken back by the fork_join that pushed it, so task is last if it is there at all
+		// (unless other threads outside of the pool share the queue, then it is simply left for run_one to pick up)
+		if (!tasks.empty() && tasks.back() == task) {
+			tasks.pop_back();
+			_pending--;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	inline bool gAVLTaskPool::run_one(std::size_t q) {
+		Task* task = nullptr;
+
+		// Own tasks newest first, stolen ones oldest first (those are the biggest)
+		for (std::size_t i = 0; i < _queues.size() && task == nullptr; ++i) {
+			Queue& queue = *_queues[(q + i) % _queues.size()];
+			std::lock_guard<std::mutex> lock(queue._mutex);
+
+			if (!queue._tasks.empty()) {
+				if (i == 0) {
+					task = queue._tasks.back();
+					queue._tasks.pop_back();
+				} else {
+					task = queue._tasks.front();
+					queue._tasks.pop_front();
+				}
+
+				_pending--;
+			}
+		}
+
+		if (task == nullptr) {
+			return false;
+		}
+
+		run(task);
+
+		return true;
+	}
+
+	inline void gAVLTaskPool::run(Task* task) {
+		try {
+			task->_run();
+		} catch (...) {
+			task->_error = std::current_exception();
+		}
+
+		task->_done.store(true, std::memory_order_release);
+	}
+
+	inline void gAVLTaskPool::work(std::size_t q) {
+		current()._pool = this;
+		current()._queue = q;
+
+		while (true) {
+			if (run_one(q)) {
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(_idle_mutex);
+			_idle.wait(lock, [this]() { return _stop || _pending > 0; });
+
+			if (_stop) {
+				return;
+			}
+		}
+	}
+}
+
+
+#endif
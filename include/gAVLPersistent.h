@@ -0,0 +1,551 @@
+#ifndef GAVLPERSISTENT_H_
+#define GAVLPERSISTENT_H_
+
+#include <gAVL.h>
+
+#include <atomic>
+#include <vector>
+
+namespace bst {
+	// Node shared between versions of a gAVLPersistent tree, with no parent link (a node can have one parent per version it is in)
+	template <typename T>
+	struct gAVLPersistentNode {
+		template <typename... Args>
+		explicit gAVLPersistentNode(Args&&... args) : _data(std::forward<Args>(args)...), _left(nullptr), _right(nullptr), _height(1), _references(1) {}
+
+		T _data;
+		gAVLPersistentNode* _left;
+		gAVLPersistentNode* _right;
+		int _height;
+		std::atomic<std::size_t> _references;	// One per parent (or tree/snapshot root) pointing at it
+	};
+
+	// Immutable point-in-time view of a gAVLPersistent tree, sharing its nodes with the tree and any other snapshot [O(1) to copy]
+	// Snapshots can be read and released on any thread, provided the allocator can free nodes concurrently (see gAVLConcurrentAllocator)
+	template <typename T, typename Compare = gAVLCompare<T>, typename Allocator = std::allocator<T>>
+	class gAVLSnapshot {
+		public:
+			typedef Compare comparator_type;
+			typedef Allocator allocator_type;
+
+			explicit gAVLSnapshot(const Compare& comparator = Compare(), const Allocator& allocator = Allocator());
+			gAVLSnapshot(const gAVLSnapshot& other);
+			gAVLSnapshot(gAVLSnapshot&& other);
+			~gAVLSnapshot();
+
+			gAVLSnapshot& operator=(const gAVLSnapshot& other);
+			gAVLSnapshot& operator=(gAVLSnapshot&& other);
+
+			// In-order, read-only walk over the snapshot, keeping the path to the current node on a stack
+			class const_iterator {
+				public:
+					typedef std::forward_iterator_tag iterator_category;
+					typedef T value_type;
+					typedef std::ptrdiff_t difference_type;
+					typedef const T* pointer;
+					typedef const T& reference;
+
+					const_iterator() {}
+
+					reference operator*() const { return _path.back()->_data; }
+					pointer operator->() const { return &_path.back()->_data; }
+
+					const_iterator& operator++() {
+						const gAVLPersistentNode<T>* p = _path.back()->_right;
+
+						_path.pop_back();
+						descend(p);
+
+						return *this;
+					}
+
+					const_iterator operator++(int) {
+						const_iterator it = *this;
+						++(*this);
+
+						return it;
+					}
+
+					bool operator==(const const_iterator& other) const { return _path.empty() ? other._path.empty() : (!other._path.empty() && _path.back() == other._path.back()); }
+					bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+				protected:
+					explicit const_iterator(const gAVLPersistentNode<T>* root) { descend(root); }
+
+					void descend(const gAVLPersistentNode<T>* p) {
+						for (; p != nullptr; p = p->_left) {
+							_path.push_back(p);
+						}
+					}
+
+					std::vector<const gAVLPersistentNode<T>*> _path;
+
+					friend class gAVLSnapshot;
+			};
+
+			typedef const_iterator iterator;
+
+			std::size_t size() const;				// [O(1)]
+			bool contains(const T& data) const;		// [O(log(n))]
+			bool search(const T& search_data, T& found_data) const;	// [O(log(n))]
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> bool contains(const K& key) const;
+			template <typename K, typename C = Compare, typename = typename C::is_transparent> bool search(const K& search_key, T& found_data) const;
+			std::vector<T> to_stl_vector() const;	// [O(n)]
+			const_iterator begin() const;			// [O(log(n))]
+			const_iterator end() const;				// [O(1)]
+			allocator_type get_allocator() const;
+
+		protected:
+			typedef typename std::allocator_traits<Allocator>::template rebind_alloc<gAVLPersistentNode<T>> node_allocator_type;
+			typedef std::allocator_traits<node_allocator_type> node_traits;
+
+			template <typename K> const gAVLPersistentNode<T>* find(const K& key) const;
+			void release(gAVLPersistentNode<T>* node);	// Drops one reference to node, freeing it (and whatever only it referenced) along with the last one
+			static gAVLPersistentNode<T>* retain(gAVLPersistentNode<T>* node);
+
+			Compare _comparator;
+			gAVLPersistentNode<T>* _root;
+			std::size_t _size;
+			node_allocator_type _allocator;
+	};
+
+	/*
+		Persistent (copy-on-write) AVL tree: insert/remove copy the nodes along their search path instead of modifying nodes that
+		some snapshot still shares, so snapshot() is O(1) and whatever it returns never changes. Nodes only the tree itself
+		references are modified in place, so without outstanding snapshots the writes cost about what they cost in gAVL.
+
+		The tree is meant to be written from one thread at a time (snapshot() included), its snapshots can go anywhere.
+	*/
+	template <typename T, typename Compare = gAVLCompare<T>, typename Allocator = std::allocator<T>>
+	class gAVLPersistent : public gAVLSnapshot<T, Compare, Allocator> {
+		public:
+			typedef gAVLSnapshot<T, Compare, Allocator> snapshot_type;
+
+			explicit gAVLPersistent(const Compare& comparator = Compare(), const Allocator& allocator = Allocator());
+
+			bool insert(const T& data);				// Adds the data value to the tree (if it already exists in the tree, does nothing) [O(log(n))]
+			bool insert(T&& data);					// [O(log(n))]
+			template <typename... Args> bool emplace(Args&&... args);	// [O(log(n))]
+			bool remove(const T& data);				// Removes the data value from the tree (if it does not exist in the tree does nothing) [O(log(n))]
+			void clear();							// [O(1)], the nodes go with the last snapshot sharing them
+			snapshot_type snapshot() const;			// The tree as it is now, unaffected by anything done to the tree afterwards [O(1)]
+
+		protected:
+			typedef typename snapshot_type::node_traits node_traits;
+
+			template <typename... Args> gAVLPersistentNode<T>* create_node(Args&&... args);
+			gAVLPersistentNode<T>* own(gAVLPersistentNode<T>* node);	// Takes over the reference to node, returning a node only the caller references (node itself or a copy of it)
+			gAVLPersistentNode<T>* insert(gAVLPersistentNode<T>* node, gAVLPersistentNode<T>* leaf);
+			gAVLPersistentNode<T>* remove(gAVLPersistentNode<T>* node, const T& data);
+			gAVLPersistentNode<T>* remove_min(gAVLPersistentNode<T>* node, gAVLPersistentNode<T>*& min);
+			gAVLPersistentNode<T>* rebalance(gAVLPersistentNode<T>* node);
+			gAVLPersistentNode<T>* rotate_left(gAVLPersistentNode<T>* node);
+			gAVLPersistentNode<T>* rotate_right(gAVLPersistentNode<T>* node);
+			static int height(const gAVLPersistentNode<T>* node);
+			static void update_height(gAVLPersistentNode<T>* node);
+	};
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLSnapshot<T, Compare, Allocator>::gAVLSnapshot(const Compare& comparator, const Allocator& allocator) : _comparator(comparator), _root(nullptr), _size(0), _allocator(allocator) {
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLSnapshot<T, Compare, Allocator>::gAVLSnapshot(const gAVLSnapshot& other) : _comparator(other._comparator), _root(retain(other._root)), _size(other._size), _allocator(other._allocator) {
+		// The nodes stay shared, so the allocator copy has to be able to free them
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLSnapshot<T, Compare, Allocator>::gAVLSnapshot(gAVLSnapshot&& other) : _comparator(std::move(other._comparator)), _root(other._root), _size(other._size), _allocator(std::move(other._allocator)) {
+		other._root = nullptr;
+		other._size = 0;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLSnapshot<T, Compare, Allocator>::~gAVLSnapshot() {
+		release(_root);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLSnapshot<T, Compare, Allocator>& gAVLSnapshot<T, Compare, Allocator>::operator=(const gAVLSnapshot& other) {
+		if (this != &other) {
+			gAVLSnapshot tmp(other);
+			*this = std::move(tmp);
+		}
+
+		return *this;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLSnapshot<T, Compare, Allocator>& gAVLSnapshot<T, Compare, Allocator>::operator=(gAVLSnapshot&& other) {
+		if (this != &other) {
+			release(_root);
+
+			_comparator = std::move(other._comparator);
+			_allocator = std::move(other._allocator);
+			_root = other._root;
+			_size = other._size;
+
+			other._root = nullptr;
+			other._size = 0;
+		}
+
+		return *this;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	std::size_t gAVLSnapshot<T, Compare, Allocator>::size() const {
+		return _size;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	bool gAVLSnapshot<T, Compare, Allocator>::contains(const T& data) const {
+		return find(data) != nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	bool gAVLSnapshot<T, Compare, Allocator>::search(const T& search_data, T& found_data) const {
+		const gAVLPersistentNode<T>* p = find(search_data);
+
+		if (p == nullptr) {
+			return false;
+		}
+
+		found_data = p->_data;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	template <typename K, typename C, typename>
+	bool gAVLSnapshot<T, Compare, Allocator>::contains(const K& key) const {
+		return find(key) != nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	template <typename K, typename C, typename>
+	bool gAVLSnapshot<T, Compare, Allocator>::search(const K& search_key, T& found_data) const {
+		const gAVLPersistentNode<T>* p = find(search_key);
+
+		if (p == nullptr) {
+			return false;
+		}
+
+		found_data = p->_data;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	std::vector<T> gAVLSnapshot<T, Compare, Allocator>::to_stl_vector() const {
+		std::vector<T> v;
+		v.reserve(_size);
+
+		for (const_iterator it = begin(); it != end(); ++it) {
+			v.push_back(*it);
+		}
+
+		return v;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	typename gAVLSnapshot<T, Compare, Allocator>::const_iterator gAVLSnapshot<T, Compare, Allocator>::begin() const {
+		return const_iterator(_root);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	typename gAVLSnapshot<T, Compare, Allocator>::const_iterator gAVLSnapshot<T, Compare, Allocator>::end() const {
+		return const_iterator();
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	typename gAVLSnapshot<T, Compare, Allocator>::allocator_type gAVLSnapshot<T, Compare, Allocator>::get_allocator() const {
+		return allocator_type(_allocator);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	template <typename K>
+	const gAVLPersistentNode<T>* gAVLSnapshot<T, Compare, Allocator>::find(const K& key) const {
+		const gAVLPersistentNode<T>* p = _root;
+
+		while (p != nullptr) {
+			int comp = _comparator(key, p->_data);
+
+			if (comp == 0) {
+				return p;
+			}
+
+			p = (comp < 0) ? p->_left : p->_right;
+		}
+
+		return nullptr;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	void gAVLSnapshot<T, Compare, Allocator>::release(gAVLPersistentNode<T>* node) {
+		// Whatever is freed hands its references to its children down, which frees those that were only referenced by it, and so on
+		std::vector<gAVLPersistentNode<T>*> pending;
+
+		if (node != nullptr) {
+			pending.push_back(node);
+		}
+
+		while (!pending.empty()) {
+			gAVLPersistentNode<T>* p = pending.back();
+			pending.pop_back();
+
+			if (p->_references.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+				continue;
+			}
+
+			if (p->_left != nullptr) {
+				pending.push_back(p->_left);
+			}
+
+			if (p->_right != nullptr) {
+				pending.push_back(p->_right);
+			}
+
+			node_traits::destroy(_allocator, p);
+			node_traits::deallocate(_allocator, p, 1);
+		}
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLPersistentNode<T>* gAVLSnapshot<T, Compare, Allocator>::retain(gAVLPersistentNode<T>* node) {
+		if (node != nullptr) {
+			node->_references.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		return node;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLPersistent<T, Compare, Allocator>::gAVLPersistent(const Compare& comparator, const Allocator& allocator) : snapshot_type(comparator, allocator) {
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	bool gAVLPersistent<T, Compare, Allocator>::insert(const T& data) {
+		return emplace(data);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	bool gAVLPersistent<T, Compare, Allocator>::insert(T&& data) {
+		return emplace(std::move(data));
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	template <typename... Args>
+	bool gAVLPersistent<T, Compare, Allocator>::emplace(Args&&... args) {
+		gAVLPersistentNode<T>* leaf = create_node(std::forward<Args>(args)...);
+
+		// Checked first, so that nothing gets copied for a value that is already there
+		if (this->find(leaf->_data) != nullptr) {
+			this->release(leaf);
+			return false;
+		}
+
+		this->_root = insert(this->_root, leaf);
+		this->_size++;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	bool gAVLPersistent<T, Compare, Allocator>::remove(const T& data) {
+		if (this->find(data) == nullptr) {
+			return false;
+		}
+
+		this->_root = remove(this->_root, data);
+		this->_size--;
+
+		return true;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	void gAVLPersistent<T, Compare, Allocator>::clear() {
+		this->release(this->_root);
+
+		this->_root = nullptr;
+		this->_size = 0;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	typename gAVLPersistent<T, Compare, Allocator>::snapshot_type gAVLPersistent<T, Compare, Allocator>::snapshot() const {
+		return snapshot_type(*this);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	template <typename... Args>
+	gAVLPersistentNode<T>* gAVLPersistent<T, Compare, Allocator>::create_node(Args&&... args) {
+		gAVLPersistentNode<T>* node = node_traits::allocate(this->_allocator, 1);
+
+		try {
+			node_traits::construct(this->_allocator, node, std::forward<Args>(args)...);
+		} catch (...) {
+			node_traits::deallocate(this->_allocator, node, 1);
+			throw;
+		}
+
+		return node;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLPersistentNode<T>* gAVLPersistent<T, Compare, Allocator>::own(gAVLPersistentNode<T>* node) {
+		// A node referenced once is referenced by the (already owned) node the caller came from, nobody else can see it change
+		if (node->_references.load(std::memory_order_acquire) == 1) {
+			return node;
+		}
+
+		gAVLPersistentNode<T>* copy = create_node(node->_data);
+
+		copy->_left = snapshot_type::retain(node->_left);
+		copy->_right = snapshot_type::retain(node->_right);
+		copy->_height = node->_height;
+
+		this->release(node);
+
+		return copy;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLPersistentNode<T>* gAVLPersistent<T, Compare, Allocator>::insert(gAVLPersistentNode<T>* node, gAVLPersistentNode<T>* leaf) {
+		// Takes over the reference to node, returns the (owned) root of the subtree with leaf in it
+		if (node == nullptr) {
+			return leaf;
+		}
+
+		node = own(node);
+
+		if (this->_comparator(leaf->_data, node->_data) < 0) {
+			node->_left = insert(node->_left, leaf);
+		} else {
+			node->_right = insert(node->_right, leaf);
+		}
+
+		return rebalance(node);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLPersistentNode<T>* gAVLPersistent<T, Compare, Allocator>::remove(gAVLPersistentNode<T>* node, const T& data) {
+		// Takes over the reference to node (data is known to be in its subtree), returns the root of the subtree without data
+		node = own(node);
+
+		int comp = this->_comparator(data, node->_data);
+
+		if (comp < 0) {
+			node->_left = remove(node->_left, data);
+			return rebalance(node);
+		} else if (comp > 0) {
+			node->_right = remove(node->_right, data);
+			return rebalance(node);
+		}
+
+		gAVLPersistentNode<T>* replacement = nullptr;
+
+		if (node->_left == nullptr || node->_right == nullptr) {
+			// The only child (if any) takes its place
+			replacement = (node->_left != nullptr) ? node->_left : node->_right;
+		} else {
+			// The successor takes its place
+			gAVLPersistentNode<T>* right = remove_min(node->_right, replacement);
+
+			replacement->_left = node->_left;
+			replacement->_right = right;
+			replacement = rebalance(replacement);
+		}
+
+		// Its references went to replacement
+		node->_left = node->_right = nullptr;
+		this->release(node);
+
+		return replacement;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLPersistentNode<T>* gAVLPersistent<T, Compare, Allocator>::remove_min(gAVLPersistentNode<T>* node, gAVLPersistentNode<T>*& min) {
+		// Detaches the leftmost node of the subtree as min (owned, with its links cleared), returns the root of what is left
+		node = own(node);
+
+		if (node->_left == nullptr) {
+			gAVLPersistentNode<T>* right = node->_right;
+
+			node->_right = nullptr;
+			min = node;
+
+			return right;
+		}
+
+		node->_left = remove_min(node->_left, min);
+
+		return rebalance(node);
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLPersistentNode<T>* gAVLPersistent<T, Compare, Allocator>::rebalance(gAVLPersistentNode<T>* node) {
+		// node is owned, its children are what they are
+		int balance_factor = height(node->_right) - height(node->_left);
+
+		if (balance_factor > 1) {
+			if (height(node->_right->_left) > height(node->_right->_right)) {
+				node->_right = rotate_right(node->_right);
+			}
+
+			return rotate_left(node);
+		} else if (balance_factor < -1) {
+			if (height(node->_left->_right) > height(node->_left->_left)) {
+				node->_left = rotate_left(node->_left);
+			}
+
+			return rotate_right(node);
+		}
+
+		update_height(node);
+
+		return node;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLPersistentNode<T>* gAVLPersistent<T, Compare, Allocator>::rotate_left(gAVLPersistentNode<T>* node) {
+		// Takes over the reference to node, its right child moves up (and has to be owned for that)
+		node = own(node);
+
+		gAVLPersistentNode<T>* pivot = own(node->_right);
+
+		node->_right = pivot->_left;
+		pivot->_left = node;
+
+		update_height(node);
+		update_height(pivot);
+
+		return pivot;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	gAVLPersistentNode<T>* gAVLPersistent<T, Compare, Allocator>::rotate_right(gAVLPersistentNode<T>* node) {
+		node = own(node);
+
+		gAVLPersistentNode<T>* pivot = own(node->_left);
+
+		node->_left = pivot->_right;
+		pivot->_right = node;
+
+		update_height(node);
+		update_height(pivot);
+
+		return pivot;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	int gAVLPersistent<T, Compare, Allocator>::height(const gAVLPersistentNode<T>* node) {
+		return (node == nullptr) ? 0 : node->_height;
+	}
+
+	template <typename T, typename Compare, typename Allocator>
+	void gAVLPersistent<T, Compare, Allocator>::update_height(gAVLPersistentNode<T>* node) {
+		node->_height = 1 + std::max(height(node->_left), height(node->_right));
+	}
+}
+
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef GAVLSIMD_H_
+#define GAVLSIMD_H_
+
+#include <gAVL.h>
+
+#include <cstdint>
+#include <limits>
+
+// Widest vector extension the target was compiled for (-mavx512f, -mavx2, ... or /arch:), the scalar loop is the fallback
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if !defined(__AVX512F__) && !defined(__AVX2__) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define GAVL_SIMD_SSE2
+#endif
+
+namespace bst {
+	// Lane type keys are compared as
+	enum gAVLSimdLanes { gAVLSimdScalar, gAVLSimdInt32, gAVLSimdInt64, gAVLSimdFloat, gAVLSimdDouble };
+
+	template <typename T>
+	struct gAVLSimdLanesOf : std::integral_constant<int,
+		std::is_same<T, float>::value ? gAVLSimdFloat :
+		std::is_same<T, double>::value ? gAVLSimdDouble :
+		(!std::is_integral<T>::value || std::is_same<T, bool>::value) ? gAVLSimdScalar :
+		(sizeof(T) == 4) ? gAVLSimdInt32 :
+		(sizeof(T) == 8) ? gAVLSimdInt64 : gAVLSimdScalar> {};
+
+	// Whether Compare orders T the way operator< does and T has lanes to compare it in, so gAVLSimdRank can stand in for it
+	template <typename T, typename Compare>
+	struct gAVLSimdOrdered : std::integral_constant<bool, gAVLSimdLanesOf<T>::value != gAVLSimdScalar &&
+		(std::is_same<Compare, gAVLCompare<T>>::value || std::is_same<Compare, gAVLCompare<void>>::value)> {};
+
+	inline unsigned gAVLSimdPopcount(unsigned bits) {
+	#if defined(__GNUC__)
+		return static_cast<unsigned>(__builtin_popcount(bits));
+	#else
+		unsigned n = 0;
+
+		for (; bits != 0; bits &= bits - 1) {
+			n++;
+		}
+
+		return n;
+	#endif
+	}
+
+	/*
+		Counts the values of the sorted run [values, values + n) before key, or not after it if inclusive -- the slot a
+		binary search would land on -- comparing key with 2 to 16 of them per instruction instead of one per step. The
+		whole run is compared, without a branch on any of the outcomes, which beats a binary search up to a few dozen
+		values. Unsigned integers are flipped into the signed range, which the lane comparisons order.
+	*/
+	template <typename T, int Lanes = gAVLSimdLanesOf<T>::value>
+	struct gAVLSimdRank {
+		static std::size_t count(const T* values, std::size_t n, T key, bool inclusive) {
+			std::size_t r = 0;
+
+			// Separate loops so each of them vectorizes on its own
+			if (inclusive) {
+				for (std::size_t i = 0; i < n; ++i) {
+					r += !(key < values[i]);
+				}
+			} else {
+				for (std::size_t i = 0; i < n; ++i) {
+					r += values[i] < key;
+				}
+			}
+
+			return r;
+		}
+	};
+
+	template <typename T>
+	struct gAVLSimdRank<T, gAVLSimdInt32> {
+		static std::size_t count(const T* values, std::size_t n, T key, bool inclusive) {
+			std::size_t r = 0;
+			std::size_t i = 0;
+			const std::int32_t bias = std::is_signed<T>::value ? 0 : std::numeric_limits<std::int32_t>::min();
+			const std::int32_t k = static_cast<std::int32_t>(static_cast<std::uint32_t>(key) ^ static_cast<std::uint32_t>(bias));
+
+		#if defined(__AVX512F__)
+			const __m512i kv = _mm512_set1_epi32(k);
+			const __m512i bv = _mm512_set1_epi32(bias);
+
+			for (; i < n; i += 16) {
+				// Masked, so the tail doesn't need a scalar loop of its own
+				const __mmask16 m = (n - i >= 16) ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << (n - i)) - 1);
+				const __m512i v = _mm512_xor_si512(_mm512_maskz_loadu_epi32(m, values + i), bv);
+
+				r += gAVLSimdPopcount(inclusive ? _mm512_mask_cmple_epi32_mask(m, v, kv) : _mm512_mask_cmplt_epi32_mask(m, v, kv));
+			}
+
+			i = n;
+		#elif defined(__AVX2__)
+			const __m256i kv = _mm256_set1_epi32(k);
+			const __m256i bv = _mm256_set1_epi32(bias);
+
+			for (; i + 8 <= n; i += 8) {
+				const __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)), bv);
+				const unsigned after = gAVLSimdPopcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, kv)))));
+				const unsigned before = gAVLSimdPopcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(kv, v)))));
+
+				r += inclusive ? 8 - after : before;
+			}
+		#elif defined(GAVL_SIMD_SSE2)
+			const __m128i kv = _mm_set1_epi32(k);
+			const __m128i bv = _mm_set1_epi32(bias);
+
+			for (; i + 4 <= n; i += 4) {
+				const __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)), bv);
+				const unsigned after = gAVLSimdPopcount(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, kv)))));
+				const unsigned before = gAVLSimdPopcount(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, kv)))));
+
+				r += inclusive ? 4 - after : before;
+			}
+		#elif defined(__aarch64__) && defined(__ARM_NEON)
+			const int32x4_t kv = vdupq_n_s32(k);
+			const int32x4_t bv = vdupq_n_s32(bias);
+
+			for (; i + 4 <= n; i += 4) {
+				const int32x4_t v = veorq_s32(vld1q_s32(reinterpret_cast<const std::int32_t*>(values + i)), bv);
+				const uint32x4_t m = inclusive ? vcleq_s32(v, kv) : vcltq_s32(v, kv);
+
+				r += vaddvq_u32(vshrq_n_u32(m, 31));
+			}
+		#endif
+			(void)k;
+
+			return r + gAVLSimdRank<T, gAVLSimdScalar>::count(values + i, n - i, key, inclusive);
+		}
+	};
+
+	template <typename T>
+	struct gAVLSimdRank<T, gAVLSimdInt64> {
+		static std::size_t count(const T* values, std::size_t n, T key, bool inclusive) {
+			std::size_t r = 0;
+			std::size_t i = 0;
+			const std::int64_t bias = std::is_signed<T>::value ? 0 : std::numeric_limits<std::int64_t>::min();
+			const std::int64_t k = static_cast<std::int64_t>(static_cast<std::uint64_t>(key) ^ static_cast<std::uint64_t>(bias));
+
+		#if defined(__AVX512F__)
+			const __m512i kv = _mm512_set1_epi64(k);
+			const __m512i bv = _mm512_set1_epi64(bias);
+
+			for (; i < n; i += 8) {
+				const __mmask8 m = (n - i >= 8) ? static_cast<__mmask8>(0xFF) : static_cast<__mmask8>((1u << (n - i)) - 1);
+				const __m512i v = _mm512_xor_si512(_mm512_maskz_loadu_epi64(m, values + i), bv);
+
+				r += gAVLSimdPopcount(inclusive ? _mm512_mask_cmple_epi64_mask(m, v, kv) : _mm512_mask_cmplt_epi64_mask(m, v, kv));
+			}
+
+			i = n;
+		#elif defined(__AVX2__)
+			const __m256i kv = _mm256_set1_epi64x(k);
+			const __m256i bv = _mm256_set1_epi64x(bias);
+
+			for (; i + 4 <= n; i += 4) {
+				const __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)), bv);
+				const unsigned after = gAVLSimdPopcount(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, kv)))));
+				const unsigned before = gAVLSimdPopcount(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(kv, v)))));
+
+				r += inclusive ? 4 - after : before;
+			}
+		#elif defined(__SSE4_2__)
+			// 64 bit lane comparisons only came with SSE4.2
+			const __m128i kv = _mm_set1_epi64x(k);
+			const __m128i bv = _mm_set1_epi64x(bias);
+
+			for (; i + 2 <= n; i += 2) {
+				const __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)), bv);
+				const unsigned after = gAVLSimdPopcount(static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(v, kv)))));
+				const unsigned before = gAVLSimdPopcount(static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(kv, v)))));
+
+				r += inclusive ? 2 - after : before;
+			}
+		#elif defined(__aarch64__) && defined(__ARM_NEON)
+			const int64x2_t kv = vdupq_n_s64(k);
+			const int64x2_t bv = vdupq_n_s64(bias);
+
+			for (; i + 2 <= n; i += 2) {
+				const int64x2_t v = veorq_s64(vld1q_s64(reinterpret_cast<const std::int64_t*>(values + i)), bv);
+				const uint64x2_t m = inclusive ? vcleq_s64(v, kv) : vcltq_s64(v, kv);
+
+				r += static_cast<std::size_t>(vaddvq_u64(vshrq_n_u64(m, 63)));
+			}
+		#endif
+			(void)k;
+
+			return r + gAVLSimdRank<T, gAVLSimdScalar>::count(values + i, n - i, key, inclusive);
+		}
+	};
+
+	template <typename T>
+	struct gAVLSimdRank<T, gAVLSimdFloat> {
+		static std::size_t count(const T* values, std::size_t n, T key, bool inclusive) {
+			std::size_t r = 0;
+			std::size_t i = 0;
+
+		#if defined(__AVX512F__)
+			const __m512 kv = _mm512_set1_ps(key);
+
+			for (; i < n; i += 16) {
+				const __mmask16 m = (n - i >= 16) ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << (n - i)) - 1);
+				const __m512 v = _mm512_maskz_loadu_ps(m, values + i);
+
+				r += gAVLSimdPopcount(inclusive ? _mm512_mask_cmp_ps_mask(m, v, kv, _CMP_LE_OQ) : _mm512_mask_cmp_ps_mask(m, v, kv, _CMP_LT_OQ));
+			}
+
+			i = n;
+		#elif defined(__AVX2__)
+			const __m256 kv = _mm256_set1_ps(key);
+
+			for (; i + 8 <= n; i += 8) {
+				const __m256 v = _mm256_loadu_ps(values + i);
+				const __m256 m = inclusive ? _mm256_cmp_ps(v, kv, _CMP_LE_OQ) : _mm256_cmp_ps(v, kv, _CMP_LT_OQ);
+
+				r += gAVLSimdPopcount(static_cast<unsigned>(_mm256_movemask_ps(m)));
+			}
+		#elif defined(GAVL_SIMD_SSE2)
+			const __m128 kv = _mm_set1_ps(key);
+
+			for (; i + 4 <= n; i += 4) {
+				const __m128 v = _mm_loadu_ps(values + i);
+				const __m128 m = inclusive ? _mm_cmple_ps(v, kv) : _mm_cmplt_ps(v, kv);
+
+				r += gAVLSimdPopcount(static_cast<unsigned>(_mm_movemask_ps(m)));
+			}
+		#elif defined(__aarch64__) && defined(__ARM_NEON)
+			const float32x4_t kv = vdupq_n_f32(key);
+
+			for (; i + 4 <= n; i += 4) {
+				const float32x4_t v = vld1q_f32(values + i);
+				const uint32x4_t m = inclusive ? vcleq_f32(v, kv) : vcltq_f32(v, kv);
+
+				r += vaddvq_u32(vshrq_n_u32(m, 31));
+			}
+		#endif
+
+			return r + gAVLSimdRank<T, gAVLSimdScalar>::count(values + i, n - i, key, inclusive);
+		}
+	};
+
+	template <typename T>
+	struct gAVLSimdRank<T, gAVLSimdDouble> {
+		static std::size_t count(const T* values, std::size_t n, T key, bool inclusive) {
+			std::size_t r = 0;
+			std::size_t i = 0;
+
+		#if defined(__AVX512F__)
+			const __m512d kv = _mm512_set1_pd(key);
+
+			for (; i < n; i += 8) {
+				const __mmask8 m = (n - i >= 8) ? static_cast<__mmask8>(0xFF) : static_cast<__mmask8>((1u << (n - i)) - 1);
+				const __m512d v = _mm512_maskz_loadu_pd(m, values + i);
+
+				r += gAVLSimdPopcount(inclusive ? _mm512_mask_cmp_pd_mask(m, v, kv, _CMP_LE_OQ) : _mm512_mask_cmp_pd_mask(m, v, kv, _CMP_LT_OQ));
+			}
+
+			i = n;
+		#elif defined(__AVX2__)
+			const __m256d kv = _mm256_set1_pd(key);
+
+			for (; i + 4 <= n; i += 4) {
+				const __m256d v = _mm256_loadu_pd(values + i);
+				const __m256d m = inclusive ? _mm256_cmp_pd(v, kv, _CMP_LE_OQ) : _mm256_cmp_pd(v, kv, _CMP_LT_OQ);
+
+				r += gAVLSimdPopcount(static_cast<unsigned>(_mm256_movemask_pd(m)));
+			}
+		#elif defined(GAVL_SIMD_SSE2)
+			const __m128d kv = _mm_set1_pd(key);
+
+			for (; i + 2 <= n; i += 2) {
+				const __m128d v = _mm_loadu_pd(values + i);
+				const __m128d m = inclusive ? _mm_cmple_pd(v, kv) : _mm_cmplt_pd(v, kv);
+
+				r += gAVLSimdPopcount(static_cast<unsigned>(_mm_movemask_pd(m)));
+			}
+		#elif defined(__aarch64__) && defined(__ARM_NEON)
+			const float64x2_t kv = vdupq_n_f64(key);
+
+			for (; i + 2 <= n; i += 2) {
+				const float64x2_t v = vld1q_f64(values + i);
+				const uint64x2_t m = inclusive ? vcleq_f64(v, kv) : vcltq_f64(v, kv);
+
+				r += static_cast<std::size_t>(vaddvq_u64(vshrq_n_u64(m, 63)));
+			}
+		#endif
+
+			return r + gAVLSimdRank<T, gAVLSimdScalar>::count(values + i, n - i, key, inclusive);
+		}
+	};
+}
+
+
+#endif
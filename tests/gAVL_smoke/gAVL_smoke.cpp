@@ -0,0 +1,306 @@
+// Builds every header and runs each container once against its std:: counterpart -- returns non-zero if any of them disagrees
+// (checks don't go through assert, which the default Release build compiles out)
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gAVL.h>
+#include <gAVLBTree.h>
+#include <gAVLConcurrent.h>
+#include <gAVLLazy.h>
+#include <gAVLMap.h>
+#include <gAVLMerge.h>
+#include <gAVLMultiset.h>
+#include <gAVLParallel.h>
+#include <gAVLPersistent.h>
+#include <gAVLSimd.h>
+
+using namespace bst;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+	if (!ok) {
+		std::printf("FAILED: %s\n", what);
+		failures++;
+	}
+}
+
+template <typename Container, typename Reference>
+static bool same(const Container& container, const Reference& reference) {
+	return std::vector<typename Reference::value_type>(container.begin(), container.end()) == std::vector<typename Reference::value_type>(reference.begin(), reference.end());
+}
+
+static const int operations = 20000;
+static const int keys = 1000;
+
+static void test_gAVL() {
+	std::mt19937 gen(1);
+	std::uniform_int_distribution<int> key(0, keys - 1);
+	gAVL<int> tree;
+	std::set<int> reference;
+
+	for (int i = 0; i < operations; ++i) {
+		int k = key(gen);
+
+		if (gen() % 3 == 0) {
+			check(tree.remove(k) == (reference.erase(k) == 1), "gAVL remove");
+		} else {
+			check(tree.insert(k) == reference.insert(k).second, "gAVL insert");
+		}
+	}
+
+	check(tree.size() == reference.size(), "gAVL size");
+	check(same(tree, reference), "gAVL order");
+	check(tree.to_stl_vector() == std::vector<int>(reference.begin(), reference.end()), "gAVL to_stl_vector");
+	check(same(tree.freeze(), reference), "gAVLFrozen order");
+
+	for (int k = 0; k < keys; ++k) {
+		check(tree.contains(k) == (reference.count(k) == 1), "gAVL contains");
+	}
+}
+
+static void test_gAVLBTree() {
+	std::mt19937 gen(2);
+	std::uniform_int_distribution<int> key(0, keys - 1);
+	gAVLBTree<int> tree;
+	std::set<int> reference;
+
+	for (int i = 0; i < operations; ++i) {
+		int k = key(gen);
+
+		if (gen() % 3 == 0) {
+			check(tree.remove(k) == (reference.erase(k) == 1), "gAVLBTree remove");
+		} else {
+			check(tree.insert(k) == reference.insert(k).second, "gAVLBTree insert");
+		}
+	}
+
+	check(tree.size() == reference.size(), "gAVLBTree size");
+	check(same(tree, reference), "gAVLBTree order");
+
+	for (int k = 0; k < keys; ++k) {
+		check(tree.contains(k) == (reference.count(k) == 1), "gAVLBTree contains");
+	}
+}
+
+static void test_gAVLMap() {
+	std::mt19937 gen(3);
+	std::uniform_int_distribution<int> key(0, keys - 1);
+	gAVLMap<int, int> map;
+	std::map<int, int> reference;
+
+	for (int i = 0; i < operations; ++i) {
+		int k = key(gen);
+
+		if (gen() % 3 == 0) {
+			check(map.remove(k) == (reference.erase(k) == 1), "gAVLMap remove");
+		} else {
+			map[k] += i;
+			reference[k] += i;
+		}
+	}
+
+	check(map.size() == reference.size(), "gAVLMap size");
+	check(std::vector<std::pair<int, int>>(map.begin(), map.end()) == std::vector<std::pair<int, int>>(reference.begin(), reference.end()), "gAVLMap entries");
+}
+
+static void test_gAVLMultiset() {
+	std::mt19937 gen(4);
+	std::uniform_int_distribution<int> key(0, keys / 10 - 1);
+	gAVLMultiset<int> multiset;
+	std::multiset<int> reference;
+
+	for (int i = 0; i < operations; ++i) {
+		int k = key(gen);
+
+		if (gen() % 3 == 0) {
+			std::multiset<int>::iterator found = reference.find(k);
+			bool removed = found != reference.end();
+
+			if (removed) {
+				reference.erase(found);
+			}
+
+			check(multiset.remove(k) == removed, "gAVLMultiset remove");
+		} else {
+			multiset.insert(k);
+			reference.insert(k);
+		}
+	}
+
+	check(multiset.size() == reference.size(), "gAVLMultiset size");
+	check(same(multiset, reference), "gAVLMultiset order");
+
+	for (int k = 0; k < keys / 10; ++k) {
+		check(multiset.count(k) == reference.count(k), "gAVLMultiset count");
+	}
+}
+
+static void test_gAVLMerge() {
+	std::mt19937 gen(5);
+	std::uniform_int_distribution<int> key(0, keys - 1);
+	std::vector<gAVL<int>> shards(3);
+	std::multiset<int> reference;
+
+	for (int i = 0; i < operations / 10; ++i) {
+		int k = key(gen);
+
+		if (shards[i % shards.size()].insert(k)) {
+			reference.insert(k);
+		}
+	}
+
+	gAVLMerge<gAVL<int>> merge(shards.begin(), shards.end());
+	std::vector<int> merged(merge.begin(), merge.end());
+
+	check(merged == std::vector<int>(reference.begin(), reference.end()), "gAVLMerge order");
+}
+
+static void test_gAVLLazy() {
+	std::mt19937 gen(6);
+	std::uniform_int_distribution<int> key(0, keys - 1);
+	gAVLLazy<int> tree;
+	std::set<int> reference;
+
+	for (int i = 0; i < operations; ++i) {
+		int k = key(gen);
+
+		if (gen() % 3 == 0) {
+			check(tree.remove(k) == (reference.erase(k) == 1), "gAVLLazy remove");
+		} else {
+			check(tree.insert(k) == reference.insert(k).second, "gAVLLazy insert");
+		}
+	}
+
+	check(tree.size() == reference.size(), "gAVLLazy size");
+	check(same(tree, reference), "gAVLLazy order");
+
+	tree.compact();
+
+	check(tree.tombstones() == 0, "gAVLLazy compact");
+	check(same(tree, reference), "gAVLLazy order after compact");
+}
+
+static void test_gAVLPersistent() {
+	std::mt19937 gen(7);
+	std::uniform_int_distribution<int> key(0, keys - 1);
+	gAVLPersistent<int> tree;
+	std::set<int> reference;
+	gAVLPersistent<int>::snapshot_type snapshot;
+	std::set<int> snapshot_reference;
+
+	for (int i = 0; i < operations; ++i) {
+		int k = key(gen);
+
+		if (gen() % 3 == 0) {
+			check(tree.remove(k) == (reference.erase(k) == 1), "gAVLPersistent remove");
+		} else {
+			check(tree.insert(k) == reference.insert(k).second, "gAVLPersistent insert");
+		}
+
+		if (i == operations / 2) {
+			snapshot = tree.snapshot();
+			snapshot_reference = reference;
+		}
+	}
+
+	check(tree.size() == reference.size(), "gAVLPersistent size");
+	check(same(tree, reference), "gAVLPersistent order");
+	check(same(snapshot, snapshot_reference), "gAVLSnapshot order");
+}
+
+static void test_gAVLConcurrent() {
+	std::mt19937 gen(8);
+	std::uniform_int_distribution<int> key(0, keys - 1);
+	gAVLConcurrent<int> tree;
+	std::set<int> reference;
+
+	// Odd keys stay in the tree the whole time, the reader has to find every one of them while the even ones come and go
+	for (int k = 1; k < keys; k += 2) {
+		tree.insert(k);
+		reference.insert(k);
+	}
+
+	std::atomic<bool> done(false);
+	std::atomic<bool> missed(false);
+
+	std::thread reader([&]() {
+		while (!done.load()) {
+			for (int k = 1; k < keys; k += 2) {
+				if (!tree.contains(k)) {
+					missed.store(true);
+				}
+			}
+		}
+	});
+
+	for (int i = 0; i < operations; ++i) {
+		int k = key(gen) & ~1;
+
+		if (gen() % 3 == 0) {
+			check(tree.remove(k) == (reference.erase(k) == 1), "gAVLConcurrent remove");
+		} else {
+			check(tree.insert(k) == reference.insert(k).second, "gAVLConcurrent insert");
+		}
+	}
+
+	done.store(true);
+	reader.join();
+
+	check(!missed.load(), "gAVLConcurrent concurrent contains");
+	check(tree.size() == reference.size(), "gAVLConcurrent size");
+
+	for (int k = 0; k < keys; ++k) {
+		check(tree.contains(k) == (reference.count(k) == 1), "gAVLConcurrent contains");
+	}
+}
+
+static void test_gAVLParallel() {
+	std::mt19937 gen(9);
+	std::uniform_int_distribution<int> key(0, 10 * keys - 1);
+	gAVLTaskPool pool(4);
+	gAVL<int> a, b;
+	std::set<int> reference;
+
+	for (int i = 0; i < operations; ++i) {
+		int k = key(gen);
+
+		if (i % 2 == 0) {
+			a.insert(k);
+		} else {
+			b.insert(k);
+		}
+
+		reference.insert(k);
+	}
+
+	a.union_with(std::move(b), pool);
+
+	check(a.size() == reference.size(), "gAVLParallel union size");
+	check(a.to_stl_vector(pool) == std::vector<int>(reference.begin(), reference.end()), "gAVLParallel union order");
+}
+
+int main(void) {
+	test_gAVL();
+	test_gAVLBTree();
+	test_gAVLMap();
+	test_gAVLMultiset();
+	test_gAVLMerge();
+	test_gAVLLazy();
+	test_gAVLPersistent();
+	test_gAVLConcurrent();
+	test_gAVLParallel();
+
+	if (failures != 0) {
+		std::printf("%d checks failed\n", failures);
+		return 1;
+	}
+
+	std::printf("All checks passed\n");
+	return 0;
+}